@@ -113,6 +113,7 @@ macro (setup_smce_resources)
   copy_runtime_module (InstallArduinoPrelude)
   copy_runtime_module (JuniperTranspile)
   copy_runtime_module (LegacyPreprocessing)
+  copy_runtime_module (PreparePlugin)
   copy_runtime_module (Preprocessing)
   copy_runtime_module (ProcessManifests)
   copy_runtime_module (ProbeCompilerIncdirs)
@@ -125,12 +126,21 @@ macro (setup_smce_resources)
   copy_at_build (FILES "${PROJECT_SOURCE_DIR}/share/Ardrivo/sketch_main.cpp" DESTINATION "${SMCE_RTRES_DIR}/Ardrivo/share/")
 
   set(SMCE_RESOURCES_ARK "${PROJECT_BINARY_DIR}/SMCE_Resources.zip")
+  set (ARDRIVO_STATIC_NAMES "")
+  set (ARDRIVO_STATIC_COPY)
+  set (ARDRIVO_STATIC_TARGET)
+  if (TARGET Ardrivo_static)
+    set (ARDRIVO_STATIC_TARGET Ardrivo_static)
+    set (ARDRIVO_STATIC_NAMES [[set (ARDRIVO_STATIC_FILE_NAME "$<TARGET_FILE_NAME:Ardrivo_static>")]])
+    set (ARDRIVO_STATIC_COPY COMMAND "${CMAKE_COMMAND}" -E copy "$<TARGET_FILE:Ardrivo_static>" "${SMCE_RTRES_DIR}/Ardrivo/bin")
+  endif ()
   file (GENERATE
       OUTPUT "${SMCE_RTRES_DIR}/Ardrivo/share/ArdrivoOutputNames.cmake"
-      CONTENT [[ #HSD Generated
-        set (ARDRIVO_FILE_NAME "$<TARGET_FILE_NAME:Ardrivo>")
-        set (ARDRIVO_LINKER_FILE_NAME "$<TARGET_LINKER_FILE_NAME:Ardrivo>")
-      ]]
+      CONTENT " #HSD Generated
+        set (ARDRIVO_FILE_NAME \"$<TARGET_FILE_NAME:Ardrivo>\")
+        set (ARDRIVO_LINKER_FILE_NAME \"$<TARGET_LINKER_FILE_NAME:Ardrivo>\")
+        ${ARDRIVO_STATIC_NAMES}
+      "
   )
 
   file (MAKE_DIRECTORY "${SMCE_RTRES_DIR}/Ardrivo/include")
@@ -153,9 +163,11 @@ macro (setup_smce_resources)
   add_custom_command (OUTPUT "${SMCE_RESOURCES_ARK}"
       COMMAND "${CMAKE_COMMAND}" -E copy "$<TARGET_FILE:Ardrivo>" "${SMCE_RTRES_DIR}/Ardrivo/bin"
       COMMAND "${CMAKE_COMMAND}" -E copy "$<TARGET_LINKER_FILE:Ardrivo>" "${SMCE_RTRES_DIR}/Ardrivo/bin"
+      ${ARDRIVO_STATIC_COPY}
       COMMAND "${CMAKE_COMMAND}" -E tar cf "${SMCE_RESOURCES_ARK}" --format=zip -- "${SMCE_RTRES_DIR}"
       DEPENDS
         Ardrivo
+        ${ARDRIVO_STATIC_TARGET}
         "${SMCE_RTRES_DIR}/Ardrivo/share/sketch_main.cpp"
         "${SMCE_RTRES_DIR}/SMCE/share/CMake/Runtime/CMakeLists.txt"
         "${SMCE_RTRES_DIR}/SMCE/share/CMake/Scripts/ConfigureSketch.cmake"
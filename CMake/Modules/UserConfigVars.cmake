@@ -57,3 +57,5 @@ else ()
 endif ()
 
 option (SMCE_ARDRIVO_OV767X "Set to \"Off\" to disable OV767X integration in Ardrivo" On)
+option (SMCE_ARDRIVO_API_COUNTERS "Set to \"On\" to count calls, failures, and time spent per Ardrivo entry point" Off)
+option (SMCE_ARDRIVO_STATIC "Set to \"Off\" to disable building the static Ardrivo used by the performance sketch profile" On)
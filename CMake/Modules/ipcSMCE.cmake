@@ -26,7 +26,11 @@ set_property (TARGET ipcSMCE PROPERTY POSITION_INDEPENDENT_CODE On)
 target_link_libraries (ipcSMCE PUBLIC iSMCE)
 target_compile_definitions (ipcSMCE PUBLIC SMCE_LIB_BUILD=1)
 target_sources (ipcSMCE PRIVATE
+    include/SMCE/internal/ApiCounters.hpp
     include/SMCE/internal/BoardData.hpp
+    include/SMCE/internal/BoardEvents.hpp
+    include/SMCE/internal/ByteRing.hpp
+    include/SMCE/internal/InputRecording.hpp
     include/SMCE/BoardDeviceFieldType.hpp
     include/SMCE/BoardView.hpp
     src/SMCE/BoardView.cpp
@@ -36,6 +40,8 @@ target_sources (ipcSMCE PRIVATE
     src/SMCE/BoardDeviceView.cpp
     include/SMCE/internal/SharedBoardData.hpp
     src/SMCE/SharedBoardData.cpp
+    include/SMCE/internal/UartLink.hpp
+    src/SMCE/UartLink.cpp
 )
 if (NOT MSVC)
   target_compile_options (ipcSMCE PRIVATE "-Wall" "-Wextra" "-Wpedantic" "-Werror" "-Wcast-align")
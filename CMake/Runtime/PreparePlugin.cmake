@@ -0,0 +1,113 @@
+#
+#  PreparePlugin.cmake
+#  Copyright 2022 ItJustWorksTM
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+## Fetches, inflates, and patches a single plugin
+## Run in script mode by ProcessManifests, once per plugin, concurrently with the other plugins of the sketch
+## Must never write to stdout, as it is chained with the other workers
+
+## Expected variables
+# SMCE_DIR - Path to the SMCE dir
+# PLUGIN_NAME - Name of the plugin
+# PLUGIN_URI - Source URI of the plugin (already validated)
+# PLUGIN_PATCH_URI - Patch URI of the plugin (already validated); may be empty
+# PLUGIN_BINARY_DIR - Directory under which archives get inflated
+# PLUGIN_RESULT_FILE - File to write the source root of the prepared plugin to
+
+if (NOT CMAKE_SCRIPT_MODE_FILE)
+  message (FATAL_ERROR "This module may only be run in script mode")
+endif ()
+
+list (APPEND CMAKE_MODULE_PATH "${CMAKE_CURRENT_LIST_DIR}")
+include (DownloadCacher)
+
+macro (fetch_root mode)
+  if ("${mode}" STREQUAL "SOURCE")
+    set (uPATCH "")
+    set (upatch "")
+    set (patchu "")
+    set (spatch "")
+  elseif ("${mode}" STREQUAL "PATCH")
+    set (uPATCH "_PATCH")
+    set (upatch "_patch")
+    set (patchu "patch_")
+    set (spatch " patch")
+  else ()
+    message (FATAL_ERROR "Unknown mode \"${mode}\" for fetch_root")
+  endif ()
+
+  if (PLUGIN${uPATCH}_URI MATCHES "^file://(.+)$")
+    set (${patchu}root "${CMAKE_MATCH_1}")
+  elseif (PLUGIN${uPATCH}_URI MATCHES "^https?://(.+)$")
+    cached_download (URL "${CMAKE_MATCH_1}" DEST ark${upatch}_path RESULT_VARIABLE error_param)
+    if (error_param)
+      message (FATAL_ERROR "[Plugin ${PLUGIN_NAME}] ${error_param}")
+    endif ()
+    set (${patchu}root "${PLUGIN_BINARY_DIR}/plugins${upatch}_roots/${PLUGIN_NAME}")
+    file (REMOVE_RECURSE "${${patchu}root}")
+    file (MAKE_DIRECTORY "${${patchu}root}")
+    if (CMAKE_VERSION VERSION_GREATER_EQUAL 3.18)
+      file (ARCHIVE_EXTRACT INPUT "${ark${upatch}_path}" DESTINATION "${${patchu}root}")
+    else ()
+      execute_process (COMMAND "${CMAKE_COMMAND}" -E tar xf "${ark${upatch}_path}"
+          WORKING_DIRECTORY "${${patchu}root}"
+          RESULT_VARIABLE ark${upatch}_extract_result
+          OUTPUT_QUIET
+      )
+      if (ark${upatch}_extract_result)
+        message (FATAL_ERROR "[Plugin ${PLUGIN_NAME}] Failed to inflate${spatch} archive")
+      endif ()
+    endif ()
+  else ()
+    message (FATAL_ERROR "[Plugin ${PLUGIN_NAME}] Malformed${spatch} URI (${PLUGIN${uPATCH}_URI})")
+  endif ()
+endmacro ()
+
+fetch_root (SOURCE)
+if (PLUGIN_PATCH_URI)
+  fetch_root (PATCH)
+endif ()
+
+# Find the intended root dir if source was downloaded
+if (NOT "${PLUGIN_URI}" STREQUAL "file://${root}")
+  while (1)
+    file (GLOB root_files "${root}/*")
+    list (LENGTH root_files root_files_count)
+    if (root_files_count EQUAL 0)
+      message (FATAL_ERROR "[Plugin ${PLUGIN_NAME}] Unable to deduce root directory in inflated archive")
+    elseif (root_files_count EQUAL 1 AND IS_DIRECTORY "${root_files}")
+      set (root "${root_files}")
+    else ()
+      break ()
+    endif ()
+  endwhile ()
+endif ()
+
+if (PLUGIN_PATCH_URI)
+  # Merge-in the patch tree
+  file (GLOB_RECURSE patch_relfiles LIST_DIRECTORIES false RELATIVE "${patch_root}" "${patch_root}/*")
+  foreach (patch_relfile ${patch_relfiles})
+    if (CMAKE_VERSION VERSION_GREATER_EQUAL "3.20")
+      cmake_path (GET patch_relfile PARENT_PATH patch_relfile_dir)
+    else ()
+      get_filename_component (patch_relfile_dir "${patch_relfile}" DIRECTORY)
+    endif ()
+    file (MAKE_DIRECTORY "${root}/${patch_relfile_dir}")
+    file (COPY "${patch_root}/${patch_relfile}" DESTINATION "${root}/${patch_relfile_dir}")
+  endforeach ()
+endif ()
+
+file (WRITE "${PLUGIN_RESULT_FILE}" "${root}")
@@ -44,6 +44,16 @@ if (MSVC AND NOT CMAKE_CXX_SIMULATE_ID)
   set (WINSDK_INCDIR "${WINSDK_ROOT}/Include/${CMAKE_VS_WINDOWS_TARGET_PLATFORM_VERSION}/")
   list (APPEND COMPILER_INCLUDE_DIRS "${WINSDK_INCDIR}/ucrt" "${WINSDK_INCDIR}/um" "${WINSDK_INCDIR}/shared")
 else ()
+  # Probing spawns the compiler; reuse earlier results for the same compiler binary and flags
+  file (TIMESTAMP "${CMAKE_CXX_COMPILER}" compiler_mtime "%s" UTC)
+  string (SHA256 probe_key "${CMAKE_CXX_COMPILER}|${compiler_mtime}|${CMAKE_CXX_COMPILER_ID}|${CMAKE_CXX_COMPILER_VERSION}|${CMAKE_CXX_FLAGS}")
+  set (probe_cache_file "${SMCE_DIR}/toolchain_cache/incdirs-${probe_key}.cmake")
+  if (compiler_mtime AND EXISTS "${probe_cache_file}")
+    include ("${probe_cache_file}")
+    message (DEBUG "Compiler include dirs (cached): ${COMPILER_INCLUDE_DIRS}")
+    return ()
+  endif ()
+
   if (MSVC)
     file (TO_NATIVE_PATH "${PROJECT_BINARY_DIR}/empty" EMPTY_FILE_MSPATH)
     separate_arguments (cxx_flags_list WINDOWS_COMMAND ${CMAKE_CXX_FLAGS})
@@ -73,4 +83,10 @@ else ()
     string (STRIP "${DIR}" DIR)
     list (APPEND COMPILER_INCLUDE_DIRS "${DIR}")
   endforeach ()
+
+  if (compiler_mtime)
+    string (RANDOM LENGTH 8 tmp_suffix)
+    file (WRITE "${probe_cache_file}.${tmp_suffix}" "set (COMPILER_INCLUDE_DIRS [==[${COMPILER_INCLUDE_DIRS}]==])\n")
+    file (RENAME "${probe_cache_file}.${tmp_suffix}" "${probe_cache_file}")
+  endif ()
 endif ()
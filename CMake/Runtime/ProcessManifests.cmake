@@ -15,7 +15,7 @@
 #  limitations under the License.
 #
 
-include (DownloadCacher)
+set (SMCE_PREPARE_PLUGIN_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/PreparePlugin.cmake")
 
 function (process_manifests)
   file (GLOB manifests "${CMAKE_SOURCE_DIR}/manifests/*.cmake")
@@ -87,7 +87,138 @@ function (process_manifests)
     unset (PLUGIN_NAME)
   endforeach ()
 
-  # FIXME scan plugin dependencies, and sort the plugins list accordingly
+  # Sort the plugins topologically according to their dependencies
+  set (sorted_plugins)
+  function (visit_plugin plugin)
+    list (FIND sorted_plugins "${plugin}" sorted_idx)
+    if (NOT sorted_idx EQUAL -1)
+      return ()
+    endif ()
+    list (FIND visiting "${plugin}" visiting_idx)
+    if (NOT visiting_idx EQUAL -1)
+      list (SUBLIST visiting ${visiting_idx} -1 cycle)
+      list (APPEND cycle "${plugin}")
+      string (REPLACE ";" " -> " cycle "${cycle}")
+      message (FATAL_ERROR "[Plugin ${plugin}] Circular dependency (${cycle})")
+    endif ()
+
+    list (APPEND visiting "${plugin}")
+    foreach (dependency ${PLUGIN_${plugin}_DEPENDS})
+      list (FIND plugins "${dependency}" dependency_idx)
+      if (dependency_idx EQUAL -1)
+        message (FATAL_ERROR "[Plugin ${plugin}] Depends on unknown plugin \"${dependency}\"")
+      endif ()
+      visit_plugin ("${dependency}")
+    endforeach ()
+
+    list (APPEND sorted_plugins "${plugin}")
+    set (sorted_plugins "${sorted_plugins}" PARENT_SCOPE)
+  endfunction ()
+
+  set (visiting)
+  foreach (plugin ${plugins})
+    visit_plugin ("${plugin}")
+  endforeach ()
+  message (DEBUG "Plugins in dependency order: ${sorted_plugins}")
+  set (SMCE_PLUGIN_ORDER "${sorted_plugins}" PARENT_SCOPE)
+
+  # Validate URIs up-front; remote or patched plugins need preparation, local ones can be used in-place
+  set (prepared_plugins)
+  foreach (plugin ${sorted_plugins})
+    macro (check_uri uPATCH spatch)
+      if (PLUGIN_${plugin}${uPATCH}_URI MATCHES "^file://(.+)$")
+        if (NOT IS_ABSOLUTE "${CMAKE_MATCH_1}")
+          message (FATAL_ERROR "[Plugin ${plugin}]${spatch} URI is not absolute (${CMAKE_MATCH_1})")
+        elseif (NOT EXISTS "${CMAKE_MATCH_1}" OR NOT IS_DIRECTORY "${CMAKE_MATCH_1}")
+          message (FATAL_ERROR "[Plugin ${plugin}]${spatch} URI does not point to a valid directory (\"${CMAKE_MATCH_1}\")")
+        endif ()
+      elseif (PLUGIN_${plugin}${uPATCH}_URI MATCHES "^https?://(.+)$")
+      elseif (NOT DEFINED PLUGIN_${plugin}${uPATCH}_URI)
+        message (FATAL_ERROR "[Plugin ${plugin}] No${spatch} URI")
+      else ()
+        message (FATAL_ERROR "[Plugin ${plugin}] Malformed${spatch} URI (${PLUGIN_${plugin}${uPATCH}_URI})")
+      endif ()
+    endmacro ()
+    check_uri ("" "")
+    if (PLUGIN_${plugin}_PATCH_URI)
+      check_uri ("_PATCH" " patch")
+    endif ()
+
+    if (NOT PLUGIN_${plugin}_PATCH_URI AND PLUGIN_${plugin}_URI MATCHES "^file://(.+)$")
+      set (PLUGIN_${plugin}_ROOT "${CMAKE_MATCH_1}")
+    else ()
+      list (APPEND prepared_plugins "${plugin}")
+    endif ()
+  endforeach ()
+
+  # Fetch, inflate, and patch plugins concurrently; this never depends on other plugins,
+  # so only target declaration below needs to follow the dependency order
+  if (DEFINED ENV{SMCE_PLUGIN_JOBS})
+    set (prep_jobs "$ENV{SMCE_PLUGIN_JOBS}")
+  else ()
+    # Mostly waiting on the network; don't let a small core count serialize the downloads
+    cmake_host_system_information (RESULT prep_jobs QUERY NUMBER_OF_LOGICAL_CORES)
+    if (prep_jobs LESS 4)
+      set (prep_jobs 4)
+    endif ()
+  endif ()
+  if (NOT prep_jobs GREATER 0)
+    set (prep_jobs 1)
+  endif ()
+
+  function (prepare_plugins)
+    if (NOT ARGN)
+      return ()
+    endif ()
+
+    set (prep_commands)
+    foreach (plugin ${ARGN})
+      message (STATUS "[Plugin ${plugin}] Preparing...")
+      set (result_file "${CMAKE_BINARY_DIR}/plugins_prep/${plugin}.root")
+      file (REMOVE "${result_file}")
+      list (APPEND prep_commands COMMAND "${CMAKE_COMMAND}"
+          "-DSMCE_DIR=${SMCE_DIR}"
+          "-DPLUGIN_NAME=${plugin}"
+          "-DPLUGIN_URI=${PLUGIN_${plugin}_URI}"
+          "-DPLUGIN_PATCH_URI=${PLUGIN_${plugin}_PATCH_URI}"
+          "-DPLUGIN_BINARY_DIR=${CMAKE_BINARY_DIR}"
+          "-DPLUGIN_RESULT_FILE=${result_file}"
+          -P "${SMCE_PREPARE_PLUGIN_SCRIPT}"
+      )
+    endforeach ()
+
+    # Multiple COMMANDs run concurrently as a pipeline; workers stay silent on stdout
+    execute_process (${prep_commands}
+        RESULTS_VARIABLE prep_results
+        ERROR_VARIABLE prep_errors
+        OUTPUT_QUIET
+    )
+
+    set (prep_idx 0)
+    foreach (plugin ${ARGN})
+      list (GET prep_results ${prep_idx} prep_result)
+      math (EXPR prep_idx "${prep_idx} + 1")
+      set (result_file "${CMAKE_BINARY_DIR}/plugins_prep/${plugin}.root")
+      if (NOT prep_result STREQUAL "0" OR NOT EXISTS "${result_file}")
+        message (FATAL_ERROR "[Plugin ${plugin}] Preparation failed (${prep_result})\n${prep_errors}")
+      endif ()
+      file (READ "${result_file}" root)
+      set (PLUGIN_${plugin}_ROOT "${root}" PARENT_SCOPE)
+      message (STATUS "[Plugin ${plugin}] Prepared")
+    endforeach ()
+  endfunction ()
+
+  file (MAKE_DIRECTORY "${CMAKE_BINARY_DIR}/plugins_prep")
+  set (prep_batch)
+  foreach (plugin ${prepared_plugins})
+    list (APPEND prep_batch "${plugin}")
+    list (LENGTH prep_batch prep_batch_size)
+    if (prep_batch_size EQUAL prep_jobs)
+      prepare_plugins (${prep_batch})
+      set (prep_batch)
+    endif ()
+  endforeach ()
+  prepare_plugins (${prep_batch})
 
   function (process_plugin plugin)
     macro (pass_through suff)
@@ -106,98 +237,11 @@ function (process_manifests)
     pass_through (SOURCES)
     pass_through (LINKDIRS)
     pass_through (LINKBINS)
+    set (root "${PLUGIN_${PLUGIN_NAME}_ROOT}")
 
     message (DEBUG "Processing plugin ${PLUGIN_NAME}")
-
-    macro (get_root mode)
-      if ("${mode}" STREQUAL "SOURCE")
-        set (uPATCH "")
-        set (upatch "")
-        set (patchu "")
-        set (sPatch "")
-        set (spatch "")
-      elseif ("${mode}" STREQUAL "PATCH")
-        set (uPATCH "_PATCH")
-        set (upatch "_patch")
-        set (patchu "patch_")
-        set (sPatch " Patch")
-        set (spatch " patch")
-      else ()
-        message (FATAL_ERROR "Unknown mode \"${mode}\" for get_root")
-      endif ()
-
-      if (PLUGIN${uPATCH}_URI MATCHES "^file://(.+)$")
-        if (NOT IS_ABSOLUTE "${CMAKE_MATCH_1}")
-          message (FATAL_ERROR "[Plugin ${PLUGIN_NAME}] ${sPatch} URI is not absolute (${CMAKE_MATCH_1})")
-        elseif (NOT EXISTS "${CMAKE_MATCH_1}" OR NOT IS_DIRECTORY "${CMAKE_MATCH_1}")
-          message (FATAL_ERROR "[Plugin ${PLUGIN_NAME}] ${sPatch} URI does not point to a valid directory (\"${CMAKE_MATCH_1}\")")
-        endif ()
-        set (${patchu}root "${CMAKE_MATCH_1}")
-
-      elseif (PLUGIN${uPATCH}_URI MATCHES "^https?://(.+)$")
-        cached_download (URL "${CMAKE_MATCH_1}" DEST ark${upatch}_path RESULT_VARIABLE error_param)
-        if (error_param)
-          message (FATAL_ERROR "${error_param}")
-        endif ()
-        message (STATUS "[Plugin ${PLUGIN_NAME}] Inflating${spatch}...")
-        set (${patchu}root "${CMAKE_BINARY_DIR}/plugins${upatch}_roots/${PLUGIN_NAME}")
-        file (MAKE_DIRECTORY "${${patchu}root}")
-        if (CMAKE_VERSION VERSION_GREATER_EQUAL 3.18)
-          file (ARCHIVE_EXTRACT INPUT "${ark${upatch}_path}" DESTINATION "${${patchu}root}")
-        else ()
-          execute_process (COMMAND "${CMAKE_COMMAND}" -E tar xf "${CMAKE_MATCH_1}" "${ark${upatch}_path}"
-              WORKING_DIRECTORY "${${patchu}root}"
-              RESULT_VARIABLE ark${upatch}_extract_result
-          )
-          if (ark${upatch}_extract_result)
-            message (FATAL_ERROR "[Plugin ${PLUGIN_NAME}] Failed to inflate${spatch} archive")
-          endif ()
-        endif ()
-
-      elseif (NOT DEFINED PLUGIN${uPATCH}_URI)
-        message (FATAL_ERROR "[Plugin ${PLUGIN_NAME}] No${spatch} URI")
-      else ()
-        message (FATAL_ERROR "[Plugin ${PLUGIN_NAME}] Malformed${spatch} URI (${PLUGIN${uPATCH}_URI})")
-      endif ()
-    endmacro ()
-    get_root (SOURCE)
-    if (PLUGIN_PATCH_URI)
-      get_root (PATCH)
-    endif ()
-
-    # Find the intended root dir if source was downloaded
-    if (NOT "${PLUGIN_URI}" STREQUAL "file://${root}")
-      while (1)
-        file (GLOB root_files "${root}/*")
-        list (LENGTH root_files root_files_count)
-        if (root_files_count EQUAL 0)
-          message (FATAL_ERROR "[Plugin ${PLUGIN_NAME}] Unable to deduce root directory in inflated archive")
-        elseif (root_files_count EQUAL 1 AND IS_DIRECTORY "${root_files}")
-          set (root "${root_files}")
-        else ()
-          break ()
-        endif ()
-      endwhile ()
-    endif ()
-
     message (DEBUG "[Plugin ${PLUGIN_NAME}] Root is ${root}")
 
-    if (PLUGIN_PATCH_URI)
-      # Merge-in the patch tree
-      message (STATUS "[Plugin ${PLUGIN_NAME}] Patching...")
-      file (GLOB_RECURSE patch_relfiles LIST_DIRECTORIES false RELATIVE "${patch_root}" "${patch_root}/*")
-      foreach (patch_relfile ${patch_relfiles})
-        if (CMAKE_VERSION VERSION_GREATER_EQUAL "3.20")
-          cmake_path (GET patch_relfile PARENT_PATH patch_relfile_dir)
-        else ()
-          get_filename_component (patch_relfile_dir "${patch_relfile}" DIRECTORY)
-        endif ()
-        file (MAKE_DIRECTORY "${root}/${patch_relfile_dir}")
-        file (COPY "${patch_root}/${patch_relfile}" DESTINATION "${root}/${patch_relfile_dir}")
-      endforeach ()
-      message (STATUS "[Plugin ${PLUGIN_NAME}] Patching complete")
-    endif ()
-
     # Expand defaults
     set (plugin_defaulted_incdirs)
     set (plugin_defaulted_sources)
@@ -304,7 +348,7 @@ function (process_manifests)
     target_link_libraries (Sketch PUBLIC smce_plugin_${PLUGIN_NAME})
   endfunction ()
 
-  foreach (plugin ${plugins})
+  foreach (plugin ${sorted_plugins})
     process_plugin ("${plugin}")
   endforeach ()
 endfunction ()
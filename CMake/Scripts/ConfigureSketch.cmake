@@ -21,6 +21,9 @@
 # SKETCH_FQBN - Fully qualified board name to use
 # SKETCH_PATH - Path to the Arduino sketch
 # PREPROC_REMOTE_LIBS - whitespace-separated of remote libs to pull for legacy preprocessing
+# SKETCH_PROFILE - Build profile of the sketch; empty for the default one
+# SKETCH_PGO - Profile-guided optimization mode of the sketch; empty if disabled
+# SKETCH_PGO_DIR - Directory holding the profile data
 
 ## Optional env
 # SMCE_LEGACY_PREPROCESSING - use arduino-cli to preprocess instead of arduino-prelude
@@ -132,6 +135,6 @@ elseif (EXISTS "${SMCE_DIR}/RtResources/ClangVcrt/ClangVcrt.cmake.in")
   set (ENV{PATH} "${SMCE_DIR}/RtResources/ClangVcrt/ninja/bin;$ENV{PATH}")
 endif ()
 
-execute_process (COMMAND "${CMAKE_COMMAND}" "-DSMCE_DIR=${SMCE_DIR}" "-DARDPRE_EXECUTABLE=${ARDPRE_EXECUTABLE}" "-DSKETCH_DIR=${SKETCH_DIR}" ${TOOLCHAIN} -S "${COMP_DIR}" -B "${COMP_DIR}/build")
+execute_process (COMMAND "${CMAKE_COMMAND}" "-DSMCE_DIR=${SMCE_DIR}" "-DARDPRE_EXECUTABLE=${ARDPRE_EXECUTABLE}" "-DSKETCH_DIR=${SKETCH_DIR}" "-DSKETCH_PROFILE=${SKETCH_PROFILE}" "-DSKETCH_PGO=${SKETCH_PGO}" "-DSKETCH_PGO_DIR=${SKETCH_PGO_DIR}" ${TOOLCHAIN} -S "${COMP_DIR}" -B "${COMP_DIR}/build")
 
 message (STATUS "SMCE: Sketch binary will be at \"${COMP_DIR}/build/Sketch\"")
@@ -0,0 +1,128 @@
+/*
+ *  extra/benchmarks/spawn_latency/main.cpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef SMCE_RESOURCES_DIR
+#    error "SMCE_RESOURCES_DIR is not set"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+#include <SMCE/Board.hpp>
+#include <SMCE/BoardConf.hpp>
+#include <SMCE/Sketch.hpp>
+#include <SMCE/SketchConf.hpp>
+#include <SMCE/Toolchain.hpp>
+
+using namespace std::literals;
+
+void print_help(const char* argv0) {
+    std::cout << "Usage: " << argv0 << " <fully-qualified-board-name> <path-to-sketch> [max-ballast-MiB] [iterations]"
+              << std::endl;
+}
+
+// Resident set size of this process in MiB, or 0 without procfs
+std::size_t host_rss_mib() {
+    std::ifstream statm{"/proc/self/statm"};
+    std::size_t pages = 0;
+    statm >> pages >> pages; // second field is the resident page count
+    return pages * ::sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+// Median time taken by Board::start with the given spawn method
+std::chrono::microseconds median_start_latency(const smce::Sketch& sketch, smce::BoardConfig::SpawnMethod method,
+                                               int iterations) {
+    std::vector<std::chrono::microseconds> samples;
+    for (int i = 0; i < iterations; ++i) {
+        smce::Board board;
+        board.attach_sketch(sketch);
+        board.configure({.spawn_method = method});
+        board.prepare();
+
+        const auto start = std::chrono::steady_clock::now();
+        const bool started = board.start();
+        const auto end = std::chrono::steady_clock::now();
+        if (!started) {
+            std::cerr << "Error: Board failed to start sketch" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        samples.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start));
+        board.terminate();
+    }
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    if (argc == 2 && (argv[1] == "-h"sv || argv[1] == "--help"sv)) {
+        print_help(argv[0]);
+        return EXIT_SUCCESS;
+    } else if (argc < 3 || argc > 5) {
+        print_help(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const std::size_t max_ballast_mib = argc > 3 ? std::stoul(argv[3]) : 4096;
+    const int iterations = argc > 4 ? std::stoi(argv[4]) : 20;
+
+    smce::Toolchain toolchain{SMCE_RESOURCES_DIR};
+    if (const auto ec = toolchain.check_suitable_environment()) {
+        std::cerr << "Error: " << ec.message() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    smce::Sketch sketch{argv[2], {.fqbn = argv[1]}};
+    std::cout << "Compiling..." << std::endl;
+    if (const auto ec = toolchain.compile(sketch)) {
+        std::cerr << "Error: " << ec.message() << std::endl;
+        auto [_, log] = toolchain.build_log();
+        if (!log.empty())
+            std::cerr << log << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Done" << std::endl;
+
+    using SpawnMethod = smce::BoardConfig::SpawnMethod;
+    std::cout << std::setw(16) << "host RSS (MiB)" << std::setw(16) << "fork (us)" << std::setw(16) << "vfork (us)"
+              << std::endl;
+
+    // Ballast is touched page by page so that it is resident and has to be mapped by a fork
+    std::vector<std::unique_ptr<char[]>> ballast;
+    for (std::size_t ballast_mib = 0;;) {
+        const auto fork_latency = median_start_latency(sketch, SpawnMethod::fork, iterations);
+        const auto vfork_latency = median_start_latency(sketch, SpawnMethod::vfork, iterations);
+        std::cout << std::setw(16) << host_rss_mib() << std::setw(16) << fork_latency.count() << std::setw(16)
+                  << vfork_latency.count() << std::endl;
+
+        if (ballast_mib >= max_ballast_mib)
+            break;
+        const std::size_t grow_mib = std::min(std::max<std::size_t>(ballast_mib, 256), max_ballast_mib - ballast_mib);
+        ballast.push_back(std::make_unique_for_overwrite<char[]>(grow_mib * 1024 * 1024));
+        std::memset(ballast.back().get(), 1, grow_mib * 1024 * 1024);
+        ballast_mib += grow_mib;
+    }
+}
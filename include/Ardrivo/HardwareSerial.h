@@ -62,6 +62,8 @@ struct SMCE__DLL_RT_API HardwareSerial : Stream {
 
     SMCE__NODISCARD int availableForWrite() override;
 
+    void flush() override;
+
     size_t write(std::uint8_t) override;
     size_t write(const std::uint8_t*, size_t) override;
     inline size_t write(unsigned long n) { return write((std::uint8_t)n); }
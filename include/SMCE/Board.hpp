@@ -19,9 +19,16 @@
 #ifndef SMCE_BOARD_HPP
 #define SMCE_BOARD_HPP
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <vector>
 #include <string_view>
 #include <utility>
 #include "SMCE/BoardConf.hpp"
@@ -33,6 +40,16 @@
 
 namespace smce {
 
+// clang-format off
+enum struct board_image_error {
+    invalid_state = 1,
+    malformed,
+    incompatible,
+};
+// clang-format on
+
+SMCE_API std::error_code make_error_code(board_image_error ev) noexcept;
+
 class SMCE_API Board {
   public:
     // clang-format off
@@ -48,6 +65,50 @@ class SMCE_API Board {
 
     using LockedLog = std::pair<std::unique_lock<std::mutex>, std::string&>;
 
+    /**
+     * Operating-system level resource consumption of the sketch process
+     * \note Process figures are only gathered on Linux; elsewhere they are left at zero
+     **/
+    struct ResourceUsage {
+        /// CPU time spent in user mode
+        std::chrono::nanoseconds user_time{};
+        /// CPU time spent in kernel mode
+        std::chrono::nanoseconds system_time{};
+        /// Resident set size in bytes
+        std::size_t resident_memory = 0;
+        /// Page faults serviced without I/O
+        std::uint64_t minor_faults = 0;
+        /// Page faults which required I/O
+        std::uint64_t major_faults = 0;
+        /// Switches due to the sketch blocking
+        std::uint64_t voluntary_context_switches = 0;
+        /// Switches due to preemption
+        std::uint64_t involuntary_context_switches = 0;
+        /// Size of the board's shared segment in bytes
+        std::size_t shm_size = 0;
+        /// Bytes of the shared segment in use
+        std::size_t shm_used = 0;
+        /// When the figures were collected
+        std::chrono::steady_clock::time_point sampled_at{};
+    };
+
+    /**
+     * Sources of the events raised since they were last taken
+     * \see BoardView::changes_since to find out what exactly changed
+     **/
+    struct Events {
+        /// The sketch wrote to the tx buffer of a UART channel
+        bool uart_tx = false;
+        /// The sketch wrote to a pin or changed its direction
+        bool pins = false;
+        /// The sketch published a frame
+        bool frame_buffers = false;
+        /// The sketch stored to an atomic device field
+        bool devices = false;
+        /// The sketch process exited, whatever the cause
+        bool exited = false;
+    };
+
     /**
      * Constructor
      * \param ctx - execution context to use for the sketches run in this runner
@@ -81,6 +142,64 @@ class SMCE_API Board {
     bool terminate() noexcept;
     bool stop(std::chrono::milliseconds timeout = std::chrono::milliseconds{1000}) noexcept;
 
+    /**
+     * Samples the resource usage of the running sketch
+     * \param max_age - age under which the previous sample is returned as-is instead of sampling again;
+     *                  lets dashboards poll every frame without hitting the OS each time
+     * \return the sample, or nothing if the board is neither running nor suspended
+     **/
+    [[nodiscard]] std::optional<ResourceUsage> resource_usage(std::chrono::milliseconds max_age = {}) noexcept;
+
+    /**
+     * Captures the state of the board (pins, UART buffers, device fields, framebuffers, ...) into an image
+     * \param image - buffer to write the image to
+     * \return error if the board is neither prepared nor suspended
+     * \note A sketch suspended in the middle of allocating in the shared segment makes for an unusable image
+     **/
+    std::error_code snapshot(std::vector<std::byte>& image) noexcept;
+    /// Captures the state of the board into an image file; \see snapshot
+    std::error_code snapshot(const stdfs::path& file) noexcept;
+
+    /**
+     * Replaces the state of a prepared board with the one captured in an image, in a single bulk copy
+     * \param image - image produced by \ref snapshot on a board of the same configuration and SMCE build
+     * \return error if the board is not prepared, or the image is malformed or incompatible
+     **/
+    std::error_code restore(std::span<const std::byte> image) noexcept;
+    /// Restores the state of the board from an image file, which gets mapped rather than read; \see restore
+    std::error_code restore(const stdfs::path& file) noexcept;
+
+    /**
+     * Cross-connects a UART channel of this board with one of another board, through a ring buffer shared by both
+     * sketches; bytes written to either tx show up in the rx of the other without passing through the host
+     * \param channel - index of the channel of this board
+     * \param peer - board to connect to; both boards need to be prepared
+     * \param peer_channel - index of the channel of the peer board
+     * \return `operation_not_permitted` if either board is not prepared, `invalid_argument` if a channel does not
+     *         exist or is already linked, or if both channels are paced but at different rates
+     * \note Bytes cross the link at the pace of whichever channel is paced, in both directions
+     * \note The link lasts until either board gets prepared again, reset, or destroyed, which disconnects both
+     *       channels; while it does, the host may observe the sizes of the linked buffers but not write to rx nor
+     *       read from tx
+     * \note Bytes still in the link when it goes away are dropped; the channels go back to their own buffers, which
+     *       the link left empty
+     **/
+    std::error_code link_uart(std::size_t channel, Board& peer, std::size_t peer_channel) noexcept;
+
+    /**
+     * Descriptor which becomes readable whenever the sketch raises events; lets event loops (epoll, asio, ...)
+     * wait on the board instead of polling it
+     * Stays readable until the events get taken
+     * \return -1 until the board first gets prepared, and on platforms other than Linux
+     **/
+    [[nodiscard]] int event_fd() const noexcept;
+
+    /**
+     * Takes the events raised since the previous call, rearming \ref event_fd
+     * \note Events are coalesced; each source is reported at most once per call however often it fired
+     **/
+    [[nodiscard]] Events take_events() noexcept;
+
     [[nodiscard]] inline LockedLog runtime_log() noexcept {
         return {std::unique_lock{m_runtime_log_mtx}, m_runtime_log};
     }
@@ -88,7 +207,7 @@ class SMCE_API Board {
   private:
     struct Internal;
 
-    void do_spawn() noexcept;
+    bool do_spawn() noexcept;
     void do_sweep() noexcept;
     void do_reap() noexcept;
 
@@ -103,4 +222,9 @@ class SMCE_API Board {
 
 } // namespace smce
 
+namespace std {
+template <>
+struct is_error_code_enum<smce::board_image_error> : std::bool_constant<true> {};
+} // namespace std
+
 #endif // SMCE_BOARD_HPP
@@ -19,6 +19,7 @@
 #ifndef SMCE_BOARDCONF_HPP
 #define SMCE_BOARDCONF_HPP
 
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <optional>
@@ -54,7 +55,10 @@ struct SMCE_API BoardConfig {
         std::uint16_t baud_rate = 9600;
         std::size_t rx_buffer_length = 64;
         std::size_t tx_buffer_length = 64;
-        std::size_t flushing_threshold = 0;
+        std::size_t flushing_threshold = 0; /// Bytes the board coalesces writes into, up to the tx buffer; 0 for none
+        bool flush_on_newline = false;      /// Whether coalesced writes go out at the end of every line
+        bool paced = false;                 /// Holds bytes back for as long as they take over the wire at `baud_rate`
+        std::uint8_t frame_bits = 10;       /// Bits sent per byte when paced, start and stop bits included
     };
     /*
     struct SMCE_API I2cBus {
@@ -79,6 +83,51 @@ struct SMCE_API BoardConfig {
         Direction direction;
     };
 
+    struct SMCE_API LoopPacing {
+        // clang-format off
+        enum struct Policy {
+            free_run,   /// Iterations run back-to-back, only yielding after short ones
+            fixed_rate, /// Iterations start at a fixed rate
+            adaptive,   /// Pauses between iterations grow exponentially while they perform no I/O
+        };
+        // clang-format on
+        Policy policy = Policy::free_run;
+        std::uint32_t rate = 1000;                     /// Iterations per second for fixed_rate
+        std::chrono::microseconds max_backoff{10'000}; /// Longest pause between two iterations for adaptive
+    };
+
+    /**
+     * OS scheduling of the sketch process, applied when it gets spawned
+     * \note Affinity, realtime policies, and cgroups are Linux-only; \ref smce::Board::start fails when they are
+     *       requested elsewhere or cannot be applied (e.g. for lack of privileges)
+     **/
+    struct SMCE_API Scheduling {
+        // clang-format off
+        enum struct Policy {
+            normal,   /// Time-shared scheduling weighted by `nice`
+            fifo,     /// SCHED_FIFO at `priority`
+            deadline, /// SCHED_DEADLINE with the given runtime, deadline, and period
+        };
+        // clang-format on
+        Policy policy = Policy::normal;
+        std::vector<std::uint16_t> cpu_affinity; /// CPUs the sketch may run on; empty for any
+        int nice = 0;                            /// Niceness for the normal policy, from -20 to 19
+        int priority = 1;                        /// Realtime priority for fifo, from 1 to 99
+        std::chrono::microseconds runtime{};     /// CPU time granted each period for deadline
+        std::chrono::microseconds deadline{};    /// Time from the start of a period by which runtime is due
+        std::chrono::microseconds period{};      /// Period for deadline; 0 to use the deadline
+        stdfs::path cgroup;                      /// cgroup v2 directory to place the sketch in; created if missing
+        std::uint32_t cpu_quota = 0;             /// Percentage of one CPU the cgroup may use; 0 for no limit
+    };
+
+    // clang-format off
+    /// How the sketch process gets created
+    enum struct SpawnMethod {
+        fork,  /// Duplicates the host process; the cost grows with the host's memory footprint
+        vfork, /// Lends the host's address space to the sketch until it execs; Linux-only, fork elsewhere
+    };
+    // clang-format on
+
     struct BoardDevice {
         BoardDeviceSpecification spec;
         std::size_t count;
@@ -91,6 +140,16 @@ struct SMCE_API BoardConfig {
     std::vector<SecureDigitalStorage> sd_cards;
     std::vector<FrameBuffer> frame_buffers; /// Frame-buffers (cameras & screens)
     std::vector<BoardDevice> board_devices; /// Board devices to install
+    /**
+     * Final stretch of each delay which the board busy-waits through instead of sleeping
+     * \note Trades CPU time for timing accuracy; 0 to always sleep
+     **/
+    std::chrono::microseconds delay_spin_threshold{};
+    LoopPacing loop_pacing; /// Pacing of the sketch's loop iterations
+    bool tracing = false;   /// Whether to set up trace rings and record events from the start; see \ref smce::Tracing
+    Scheduling scheduling;  /// OS scheduling of the sketch process
+    /// How the sketch process gets created
+    SpawnMethod spawn_method = SpawnMethod::vfork;
 };
 
 [[nodiscard]] SMCE_API bool operator==(const BoardConfig::GpioDrivers&, const BoardConfig::GpioDrivers&) noexcept;
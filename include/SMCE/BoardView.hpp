@@ -19,9 +19,14 @@
 #ifndef SMCE_BOARDVIEW_HPP
 #define SMCE_BOARDVIEW_HPP
 
+#include <array>
+#include <chrono>
 #include <cstdint>
+#include <optional>
 #include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 #include "SMCE/SMCE_iface.h"
 #include "SMCE/fwd.hpp"
 
@@ -140,6 +145,31 @@ class SMCE_API VirtualUartBuffer {
     std::size_t read(std::span<char>) noexcept;
     std::size_t write(std::span<const char>) noexcept;
     [[nodiscard]] char front() noexcept;
+
+    /**
+     * Bytes held by the buffer, in order, as up to two spans pointing right into its shared storage
+     * Lets the consuming side (the host for tx, the board for rx) decode them in place; they stay valid until
+     * consumed, however much the producing side writes in the meantime, and for linked channels no longer than the
+     * link lasts (\see Board::link_uart)
+     * \note Empty on the tx of a linked channel, which belongs to the peer board
+     * \note Consumers racing each other through peek and consume may see the same bytes; \ref consume itself is
+     *       serialized with \ref read
+     **/
+    [[nodiscard]] std::array<std::span<const char>, 2> peek() noexcept;
+    /// Drops the first `count` bytes of the buffer, which \ref peek handed out
+    void consume(std::size_t count) noexcept;
+
+    /**
+     * Free space of the buffer, up to `count` bytes, as up to two spans pointing right into its shared storage
+     * Lets the producing side (the host for rx, the board for tx) encode bytes in place; they only get published
+     * by \ref commit, and for linked channels stay valid no longer than the link lasts (\see Board::link_uart)
+     * \note Empty on the rx of a linked channel, which belongs to the peer board
+     * \note Producers racing each other through prepare and commit may hand out the same space; \ref commit itself
+     *       is serialized with \ref write
+     **/
+    [[nodiscard]] std::array<std::span<char>, 2> prepare(std::size_t count) noexcept;
+    /// Publishes the first `count` bytes of the space which \ref prepare handed out
+    void commit(std::size_t count) noexcept;
 };
 
 constexpr bool operator==(const VirtualUartBuffer& lhs, const VirtualUartBuffer& rhs) noexcept {
@@ -271,6 +301,146 @@ constexpr bool operator==(const FrameBuffers& lhs, const FrameBuffers& rhs) noex
     return lhs.m_bdat == rhs.m_bdat;
 }
 
+/**
+ * Deduplicated and rate-limited record of the API misuses of a sketch
+ * \note Entries are keyed by their call site and message; parameters are meant to stay out of both
+ **/
+class SMCE_API Diagnostics {
+    friend BoardView;
+    BoardData* m_bdat;
+    explicit Diagnostics(BoardData* bdat) : m_bdat{bdat} {}
+
+  public:
+    struct Entry {
+        std::string_view site;    /// API entry point which reported the misuse
+        std::string_view message; /// Description of the misuse
+        std::uint64_t count;      /// Number of occurrences so far
+    };
+
+    /// Object validity check
+    [[nodiscard]] bool exists() noexcept { return m_bdat; }
+
+    /**
+     * Record an occurrence of a misuse
+     * \param site - API entry point; truncated to 64 chars
+     * \param message - Description of the misuse; truncated to 64 chars
+     * \param log_interval - Minimum time between two occurrences of the same entry which are due to be logged
+     * \return occurrence count if this occurrence is due to be logged, 0 otherwise;
+     *         occurrences which do not fit in the table anymore go uncounted, and return 1 when due
+     **/
+    std::uint64_t report(std::string_view site, std::string_view message,
+                         std::chrono::nanoseconds log_interval) noexcept;
+
+    /// Snapshot all the entries at once; views point into the board and are valid as long as it is
+    [[nodiscard]] std::vector<Entry> entries();
+
+    /// Number of occurrences which could not be recorded due to the table being full
+    [[nodiscard]] std::uint64_t dropped() noexcept;
+};
+
+/**
+ * Snapshot of the timing statistics of a sketch's loop
+ **/
+struct SMCE_API LoopStats {
+    constexpr static std::size_t bucket_count = 40;
+
+    std::optional<std::chrono::nanoseconds> setup_duration; /// Duration of setup(); empty while it runs
+    std::uint64_t iterations = 0;                           /// Number of loop() iterations completed
+    std::chrono::nanoseconds total_duration{};              /// Time spent in loop() over all iterations
+    std::chrono::nanoseconds max_duration{};                /// Longest loop() iteration
+    /// Iteration counts by duration; bucket 0 holds 0ns, bucket i > 0 holds [2^(i-1), 2^i) ns
+    std::array<std::uint64_t, bucket_count> histogram{};
+
+    /// Mean duration of a loop() iteration
+    [[nodiscard]] std::chrono::nanoseconds mean_duration() const noexcept;
+    /**
+     * Upper bound of the duration under which a given share of the iterations ran
+     * \param p - share in [0, 1]; e.g. 0.99 for the 99th percentile
+     **/
+    [[nodiscard]] std::chrono::nanoseconds percentile(double p) const noexcept;
+};
+
+/**
+ * Accounting of the calls made by a sketch to one Ardrivo entry point
+ * \note Only gathered when Ardrivo was built with SMCE_ARDRIVO_API_COUNTERS
+ **/
+struct SMCE_API ApiCallStats {
+    std::string_view api;                      /// Entry point; e.g. "digitalRead"
+    std::uint64_t calls = 0;                   /// Calls completed
+    std::uint64_t failures = 0;                /// Calls which reported a misuse
+    std::chrono::nanoseconds total_duration{}; /// Time spent in the calls
+};
+
+/**
+ * Parts of a board which changed since a given generation
+ * \note Devices are reported once an atomic field of the same type as one of theirs gets stored to; plain fields are
+ *       written by reference, which cannot be observed, so hosts have to poll those
+ **/
+struct SMCE_API BoardChanges {
+    std::uint64_t generation = 0;           /// Generation to pass to the next query
+    std::vector<std::size_t> pins;          /// Ids of the changed pins
+    std::vector<std::size_t> uart_channels; /// Indices of the changed UART channels
+    std::vector<std::size_t> frame_buffers; /// Keys of the changed frame-buffers
+    std::vector<std::string_view> devices;  /// Names of the devices which may have changed
+
+    /// Whether nothing changed
+    [[nodiscard]] bool empty() const noexcept {
+        return pins.empty() && uart_channels.empty() && frame_buffers.empty() && devices.empty();
+    }
+};
+
+/**
+ * Trace rings of a board in shared memory; one for the sketch and one for the host
+ * \note Rings wrap around, so only the latest events of each side are kept
+ **/
+class SMCE_API Tracing {
+    friend BoardView;
+    BoardData* m_bdat;
+    explicit Tracing(BoardData* bdat) : m_bdat{bdat} {}
+
+  public:
+    // clang-format off
+    enum struct Source : std::uint8_t {
+        host,
+        board,
+    };
+    enum struct Phase : char {
+        begin = 'B',
+        end = 'E',
+        instant = 'i',
+    };
+    // clang-format on
+    constexpr static std::size_t max_name_length = 24;
+
+    struct Event {
+        std::chrono::nanoseconds timestamp; /// Steady clock time
+        Source source;
+        Phase phase;
+        std::uint32_t thread; /// Hash of the id of the recording thread
+        std::string name;
+        std::uint64_t arg; /// Free-form value; e.g. a byte count
+    };
+
+    /// Object validity check
+    [[nodiscard]] bool exists() noexcept { return m_bdat; }
+
+    [[nodiscard]] bool enabled() noexcept;
+    /// Toggles recording; boards which were not configured with tracing have no rings and stay disabled
+    void set_enabled(bool) noexcept;
+
+    /**
+     * Record an event; no-op while tracing is disabled
+     * \param name - name of the event; truncated to `max_name_length` chars
+     **/
+    void record(Source source, Phase phase, std::string_view name, std::uint64_t arg = 0) noexcept;
+
+    /// Snapshot the events currently held by both rings, ordered by time
+    [[nodiscard]] std::vector<Event> events();
+
+    /// Number of events which were overwritten by newer ones
+    [[nodiscard]] std::uint64_t overwritten() noexcept;
+};
+
 /**
  * Mutable view of the virtual board.
  * \note Must stay a no-fail interface (operations all silently fail on error and never cause UB)
@@ -279,6 +449,8 @@ class SMCE_API BoardView {
     BoardData* m_bdat{};
 
     friend BoardDeviceView;
+    friend InputRecorder;
+    friend Netlist;
     friend constexpr bool operator==(const BoardView& lhs, const BoardView& rhs) noexcept;
 
   public:
@@ -295,6 +467,8 @@ class SMCE_API BoardView {
     // VirtualI2cs i2c_buses;
     // VirtualOpaqueDevices opaque_devices;
     FrameBuffers frame_buffers{m_bdat}; /// Camera/Screen frame-buffers
+    Diagnostics diagnostics{m_bdat};    /// API misuse reports
+    Tracing tracing{m_bdat};            /// Trace rings
 
     constexpr BoardView() noexcept = default;
     explicit BoardView(BoardData& bdat) : m_bdat{&bdat} {}
@@ -305,6 +479,23 @@ class SMCE_API BoardView {
     /// Whether or not there is an active stop request from the host
     [[nodiscard]] bool stop_requested() noexcept;
 
+    /// Iterations per second of the sketch's loop, as last measured by the board
+    [[nodiscard]] double loop_rate() noexcept;
+
+    /// Sample the timing statistics of the sketch's loop; safe to call while the sketch runs
+    [[nodiscard]] LoopStats loop_stats() noexcept;
+
+    /// Sample the per-entry point call counters of Ardrivo; counters of sketch threads lag until they get flushed
+    [[nodiscard]] std::vector<ApiCallStats> api_call_stats();
+
+    /**
+     * Collect the parts of the board which changed since a previous query; lets hosts mirror a board without
+     * diffing all of it every frame
+     * \param generation - generation returned by the previous query; 0 to get everything changed so far
+     * \note Changes made while the query runs may be reported again by the next one, but are never missed
+     **/
+    [[nodiscard]] BoardChanges changes_since(std::uint64_t generation);
+
     /// Obtain the path to the root file of a storage device
     [[nodiscard]] std::string_view storage_get_root(Link link, std::uint16_t accessor) noexcept;
 };
@@ -0,0 +1,231 @@
+/*
+ *  Coroutines.hpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef LIBSMCE_COROUTINES_HPP
+#define LIBSMCE_COROUTINES_HPP
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <span>
+#include "SMCE/Board.hpp"
+#include "SMCE/BoardView.hpp"
+#include "SMCE/SMCE_iface.h"
+
+namespace smce {
+
+class Scheduler;
+
+/**
+ * Coroutine of a host scenario, run by a \ref Scheduler
+ * Starts once spawned onto a scheduler, or once awaited by another task, whose scheduler it then shares
+ **/
+class SMCE_API Task {
+  public:
+    struct promise_type {
+        Scheduler* scheduler = nullptr;
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+
+        Task get_return_object() noexcept { return Task{Handle::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept {
+            struct Resumer : std::suspend_always {
+                std::coroutine_handle<> await_suspend(Handle task) noexcept {
+                    const auto next = task.promise().continuation;
+                    return next ? next : std::noop_coroutine();
+                }
+            };
+            return Resumer{};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task(Task&& other) noexcept : m_handle{std::exchange(other.m_handle, {})} {}
+    Task& operator=(Task&& other) noexcept;
+    ~Task();
+
+    [[nodiscard]] bool await_ready() const noexcept { return !m_handle || m_handle.done(); }
+    Handle await_suspend(Handle parent) noexcept {
+        m_handle.promise().scheduler = parent.promise().scheduler;
+        m_handle.promise().continuation = parent;
+        return m_handle;
+    }
+    /// Rethrows what escaped the awaited task, if anything
+    void await_resume();
+
+  private:
+    friend Scheduler;
+    explicit Task(Handle handle) noexcept : m_handle{handle} {}
+    Handle m_handle;
+};
+
+/**
+ * Condition a task suspends on until its scheduler finds it met
+ * Conditions are sampled rather than latched; e.g. a pin toggling twice between two samples goes unnoticed
+ **/
+class SMCE_API Awaiter {
+  public:
+    Awaiter() noexcept = default;
+    Awaiter(const Awaiter&) = delete;
+    Awaiter& operator=(const Awaiter&) = delete;
+
+    /// Whether the suspended task may resume
+    [[nodiscard]] virtual bool poll() noexcept = 0;
+    /// Time past which the suspended task resumes whether or not \ref poll holds
+    [[nodiscard]] virtual std::chrono::steady_clock::time_point deadline() const noexcept {
+        return std::chrono::steady_clock::time_point::max();
+    }
+
+    [[nodiscard]] bool await_ready() noexcept { return poll(); }
+    void await_suspend(Task::Handle task);
+
+  protected:
+    ~Awaiter() = default;
+};
+
+/// \see async_read
+class SMCE_API UartReadAwaiter final : public Awaiter {
+    VirtualUartBuffer m_buf;
+    std::span<char> m_out;
+
+  public:
+    UartReadAwaiter(VirtualUartBuffer buf, std::span<char> out) noexcept : m_buf{buf}, m_out{out} {}
+    [[nodiscard]] bool poll() noexcept override { return !m_buf.exists() || m_buf.size() != 0; }
+    std::size_t await_resume() noexcept { return m_buf.read(m_out); }
+};
+
+/// Transition of a digital level
+// clang-format off
+enum class Edge {
+    rising,
+    falling,
+    any,
+};
+// clang-format on
+
+/// \see async_wait_edge
+class SMCE_API EdgeAwaiter final : public Awaiter {
+    VirtualDigitalDriver m_pin;
+    Edge m_edge;
+    bool m_level;
+
+  public:
+    EdgeAwaiter(VirtualDigitalDriver pin, Edge edge) noexcept : m_pin{pin}, m_edge{edge}, m_level{m_pin.read()} {}
+    [[nodiscard]] bool poll() noexcept override;
+    bool await_resume() const noexcept { return m_level; }
+};
+
+/// \see async_exit
+class SMCE_API ExitAwaiter final : public Awaiter {
+    Board& m_board;
+
+  public:
+    explicit ExitAwaiter(Board& board) noexcept : m_board{board} {}
+    [[nodiscard]] bool poll() noexcept override;
+    Board::Status await_resume() const noexcept { return m_board.status(); }
+};
+
+/// \see async_sleep
+class SMCE_API SleepAwaiter final : public Awaiter {
+    std::chrono::steady_clock::time_point m_deadline;
+
+  public:
+    explicit SleepAwaiter(std::chrono::steady_clock::duration duration) noexcept
+        : m_deadline{std::chrono::steady_clock::now() + duration} {}
+    [[nodiscard]] bool poll() noexcept override { return std::chrono::steady_clock::now() >= m_deadline; }
+    [[nodiscard]] std::chrono::steady_clock::time_point deadline() const noexcept override { return m_deadline; }
+    void await_resume() const noexcept {}
+};
+
+/**
+ * Waits for bytes to show up in a UART buffer, then reads them
+ * \return number of bytes read; 0 if the buffer does not exist
+ **/
+[[nodiscard]] inline UartReadAwaiter async_read(VirtualUartBuffer buf, std::span<char> out) noexcept {
+    return {buf, out};
+}
+
+/**
+ * Waits for the digital level of a pin to change
+ * \return the new level
+ **/
+[[nodiscard]] inline EdgeAwaiter async_wait_edge(VirtualPin pin, Edge edge = Edge::any) noexcept {
+    return {pin.digital(), edge};
+}
+
+/**
+ * Waits for the sketch of a board to exit, ticking the board along the way
+ * \return status of the board; not running nor suspended
+ **/
+[[nodiscard]] inline ExitAwaiter async_exit(Board& board) noexcept { return ExitAwaiter{board}; }
+
+/// Waits for some time without holding up the other tasks
+[[nodiscard]] inline SleepAwaiter async_sleep(std::chrono::steady_clock::duration duration) noexcept {
+    return SleepAwaiter{duration};
+}
+
+/**
+ * Single-threaded runner of tasks
+ * Suspended tasks are only sampled again once something may have changed: another task resumed, a watched board
+ * raised events, or a deadline passed; idle schedulers thus sleep in the kernel rather than spin.
+ * Each scheduler runs on the thread calling \ref run; several schedulers may run on as many threads.
+ **/
+class SMCE_API Scheduler {
+    struct Internal;
+    std::unique_ptr<Internal> m_internal;
+
+    friend Awaiter;
+
+  public:
+    Scheduler();
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+    ~Scheduler();
+
+    /// Takes over a task, to be started at the next pass
+    void spawn(Task task);
+
+    /**
+     * Wakes up on the events of a board; \see Board::event_fd
+     * \note The scheduler takes the events of the boards it watches; boards must outlive it or be unwatched
+     **/
+    void watch(Board& board);
+    void unwatch(Board& board) noexcept;
+
+    /**
+     * Resumes every task able to; if none was, waits up to `max_wait` for something to change and tries again
+     * \return number of tasks resumed
+     * \throw what escaped a spawned task, which then gets dropped
+     **/
+    std::size_t run_once(std::chrono::milliseconds max_wait = std::chrono::milliseconds{10});
+
+    /// Runs until every spawned task completes
+    void run();
+
+    /// Number of spawned tasks which did not complete yet
+    [[nodiscard]] std::size_t size() const noexcept;
+};
+
+} // namespace smce
+
+#endif // LIBSMCE_COROUTINES_HPP
@@ -0,0 +1,78 @@
+/*
+ *  InputRecording.hpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef LIBSMCE_INPUTRECORDING_HPP
+#define LIBSMCE_INPUTRECORDING_HPP
+
+#include <chrono>
+#include <memory>
+#include <stop_token>
+#include <system_error>
+#include "SMCE/BoardView.hpp"
+#include "SMCE/SMCE_fs.hpp"
+#include "SMCE/SMCE_iface.h"
+
+namespace smce {
+
+/**
+ * Records the inputs given to a board by this process to a file, so that they can be replayed against another run
+ * Recorded inputs are pin writes and directions, writes to UART rx buffers, framebuffer writes and device field stores.
+ * Files are append-only streams of chunks, flushed at least every 100ms; a crash loses at most the last chunk.
+ * \note Device fields are handed out by reference, so their stores are sampled by diffing the banks every
+ *       `device_poll` rather than intercepted; stores from the sketch get recorded as well.
+ **/
+class SMCE_API InputRecorder {
+    struct Internal;
+    std::unique_ptr<Internal> m_internal;
+
+  public:
+    InputRecorder() noexcept;
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+    ~InputRecorder();
+
+    /**
+     * Starts recording the inputs given to a board through any view of it in this process
+     * \param view - board to record; must outlive the recording
+     * \param location - file to write; its parent directories get created as needed
+     * \param device_poll - device fields sampling period; zero leaves device fields out
+     * \return `device_or_resource_busy` if this recorder or another one already records the board
+     **/
+    std::error_code start(BoardView view, const stdfs::path& location,
+                          std::chrono::milliseconds device_poll = std::chrono::milliseconds{10}) noexcept;
+
+    /// Stops the recording and flushes the pending inputs
+    std::error_code stop() noexcept;
+
+    /// Whether or not a recording is in progress
+    [[nodiscard]] bool recording() const noexcept;
+
+    /**
+     * Replays a recording against a board, which needs to be configured like the recorded one
+     * \param view - board to replay the inputs to
+     * \param location - recording to replay; a truncated last chunk is tolerated
+     * \param speed - pace relative to the recording; 2 plays twice as fast, 0 plays back-to-back
+     * \param stop - interrupts the replay; the inputs replayed so far stay applied
+     **/
+    static std::error_code replay(BoardView view, const stdfs::path& location, double speed = 1,
+                                  std::stop_token stop = {}) noexcept;
+};
+
+} // namespace smce
+
+#endif // LIBSMCE_INPUTRECORDING_HPP
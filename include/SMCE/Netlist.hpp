@@ -0,0 +1,88 @@
+/*
+ *  Netlist.hpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef LIBSMCE_NETLIST_HPP
+#define LIBSMCE_NETLIST_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <system_error>
+#include "SMCE/BoardView.hpp"
+#include "SMCE/SMCE_iface.h"
+
+namespace smce {
+
+/**
+ * Wiring of GPIO pins across boards
+ * A net joins pins of any number of boards; whenever one of its pins set as an output gets written, the value is
+ * copied over to those of its pins which are set as inputs.
+ * Writes are flagged in per-board dirty bitsets, so that a propagation pass only visits the pins written since the
+ * previous one, however many nets there are.
+ * \note Boards must stay prepared or running for as long as they are wired
+ **/
+class SMCE_API Netlist {
+    struct Internal;
+    std::unique_ptr<Internal> m_internal;
+
+  public:
+    /// Pin of a board
+    struct Endpoint {
+        BoardView board;
+        std::size_t pin; /// Pin id
+    };
+
+    Netlist() noexcept;
+    Netlist(const Netlist&) = delete;
+    Netlist& operator=(const Netlist&) = delete;
+    ~Netlist();
+
+    /**
+     * Declares a net
+     * \param endpoints - pins to join; at least two
+     * \return `invalid_argument` if a pin does not exist or is already part of a net, `device_or_resource_busy` if
+     *         one of the boards is wired by another netlist
+     **/
+    std::error_code connect(std::span<const Endpoint> endpoints) noexcept;
+
+    /// Number of nets
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    /// Removes all the nets and releases the boards
+    void clear() noexcept;
+
+    /**
+     * Runs a single propagation pass
+     * \return number of input pins whose value changed
+     **/
+    std::size_t propagate() noexcept;
+
+    /**
+     * Runs propagation passes from a background thread until \ref stop
+     * \param period - time between the start of two passes
+     **/
+    std::error_code start(std::chrono::microseconds period = std::chrono::microseconds{100}) noexcept;
+
+    /// Stops the background propagation
+    void stop() noexcept;
+};
+
+} // namespace smce
+
+#endif // LIBSMCE_NETLIST_HPP
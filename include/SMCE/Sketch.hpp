@@ -44,6 +44,7 @@ class SMCE_API Sketch {
     SketchConfig m_conf;
     stdfs::path m_source;
     stdfs::path m_tmpdir;
+    stdfs::path m_compdir; // where the sketch gets built; shared by the builds of a PGO cycle, else m_tmpdir
     stdfs::path m_executable;
     bool m_built = false;
     // bool m_dirty = true;
@@ -40,11 +40,31 @@ struct SMCE_API SketchConfig {
         std::string version; // Version string; empty if latest
     };
 
+    /**
+     * Build profile of the sketch
+     **/
+    enum struct Profile {
+        standard,    /// Links against the shared Ardrivo; unoptimized
+        performance, /// Links against the static Ardrivo with LTO, and optimizes the sketch (-O3); no MQTT support
+    };
+
+    /**
+     * Profile-guided optimization mode of the sketch
+     * \see Toolchain::compile_pgo
+     **/
+    enum struct Pgo {
+        off,        /// No profile-guided optimization
+        instrument, /// Records a profile of the sketch runs; shared by all sketches with the same contents
+        optimize,   /// Optimizes using the recorded profile
+    };
+
     std::string fqbn;                                      /// Fully-qualified board name that the sketch is targeting
     std::vector<std::string> extra_board_uris;             /// Extra board.txt URIs for ArduinoCLI
     std::vector<ArduinoLibrary> legacy_preproc_libs;       /// Libraries to use during legacy preprocessing
     std::vector<PluginManifest> plugins;                   /// Plugins to compile with
     std::vector<BoardDeviceSpecification> genbind_devices; /// Board devices to generate bindings for
+    Profile profile = Profile::standard;                   /// Build profile to use
+    Pgo pgo = Pgo::off;                                    /// Profile-guided optimization mode
 };
 
 } // namespace smce
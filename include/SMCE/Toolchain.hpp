@@ -19,9 +19,14 @@
 #ifndef SMCE_TOOLCHAIN_HPP
 #define SMCE_TOOLCHAIN_HPP
 
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <system_error>
+#include <thread>
 #include <SMCE/SMCE_fs.hpp>
 #include <SMCE/SMCE_iface.h>
 #include <SMCE/Sketch.hpp>
@@ -43,6 +48,10 @@ enum struct toolchain_error {
     sketch_invalid,
     configure_failed,
     build_failed,
+    compile_cancelled,
+
+    profile_missing,
+    training_failed,
 
     generic = 255
 };
@@ -50,6 +59,57 @@ enum struct toolchain_error {
 
 SMCE_API std::error_code make_error_code(toolchain_error ev) noexcept;
 
+// clang-format off
+/// Progress phases of a compilation
+enum struct CompilePhase {
+    configuring,
+    preprocessing,
+    building,
+    done
+};
+// clang-format on
+
+namespace detail {
+/// \internal
+struct CompileState;
+} // namespace detail
+
+/**
+ * Handle to a compilation started by Toolchain::compile_async
+ *
+ * Destroying a handle waits for its compilation to end;
+ * call cancel() beforehand to abort it instead.
+ * \note The Toolchain and the Sketch must outlive the compilation
+ **/
+class SMCE_API CompileHandle {
+    friend Toolchain;
+
+    std::shared_ptr<detail::CompileState> m_state;
+    std::thread m_worker;
+
+  public:
+    CompileHandle() noexcept;
+    CompileHandle(CompileHandle&&) noexcept;
+    CompileHandle& operator=(CompileHandle&&) noexcept;
+    ~CompileHandle();
+
+    /// Whether this handle refers to a compilation
+    [[nodiscard]] bool valid() const noexcept { return static_cast<bool>(m_state); }
+    /// Current phase of the compilation
+    [[nodiscard]] CompilePhase phase() const noexcept;
+    /// Whether the compilation has ended, successfully or not
+    [[nodiscard]] bool done() const noexcept { return phase() == CompilePhase::done; }
+
+    /**
+     * Requests the compilation to stop, killing the CMake processes it spawned
+     * \note Non-blocking; wait() then reports toolchain_error::compile_cancelled
+     **/
+    void cancel() noexcept;
+
+    /// Blocks until the compilation has ended and returns its result
+    std::error_code wait() noexcept;
+};
+
 /**
  * Compilation environment for sketches
  *
@@ -63,11 +123,18 @@ class SMCE_API Toolchain {
     std::string m_build_log;
     std::mutex m_build_log_mtx;
 
-    std::error_code do_configure(Sketch& sketch) noexcept;
-    std::error_code do_build(Sketch& sketch) noexcept;
+    void log_line(detail::CompileState& state, std::string&& line) noexcept;
+    std::error_code do_compile(Sketch& sketch, detail::CompileState& state) noexcept;
+    std::error_code do_configure(Sketch& sketch, detail::CompileState& state) noexcept;
+    std::error_code do_build(Sketch& sketch, detail::CompileState& state) noexcept;
 
   public:
     using LockedLog = std::pair<std::unique_lock<std::mutex>, std::string&>;
+    /// Receives the build log one line at a time, newline included
+    using LogSink = std::function<void(std::string_view)>;
+
+    /// Maximum number of bytes retained in the build log; older lines get discarded first
+    static constexpr std::size_t max_build_log_size = 1024 * 1024;
 
     /**
      * Constructor
@@ -80,11 +147,18 @@ class SMCE_API Toolchain {
     /// Getter for the CMake path
     [[nodiscard]] const std::string& cmake_path() const noexcept { return m_cmake_path; }
 
+    /**
+     * Locked access to the tail of the build log
+     * \note Prefer the LogSink of compile_async to follow a build incrementally
+     **/
     [[nodiscard]] inline LockedLog build_log() noexcept { return {std::unique_lock{m_build_log_mtx}, m_build_log}; }
 
     /**
      * Checks whether the required tools are provided
      *
+     * The results are cached in the resource directory and reused by later instances
+     * until PATH changes or the CMake (or Ninja) binary is modified.
+     *
      * \warning This function currently only checks for CMake's availability through the PATH env var
      * \todo Extend to check for a C++ >=11 compiler
      **/
@@ -94,6 +168,35 @@ class SMCE_API Toolchain {
      * Compile a sketch
      **/
     std::error_code compile(Sketch& sketch) noexcept;
+
+    /**
+     * Checks whether a profile was recorded for the current contents of a sketch
+     * \see SketchConfig::Pgo
+     **/
+    [[nodiscard]] bool has_profile(const Sketch& sketch) noexcept;
+
+    /**
+     * Compile a sketch with profile-guided optimization
+     *
+     * Unless a profile was already recorded for the contents of the sketch,
+     * an instrumented build of it first runs on a board for the training duration.
+     * \param sketch - sketch to compile; its config is switched to SketchConfig::Pgo::optimize
+     * \param training_board - configuration of the board to train on
+     * \param training_duration - how long to run the instrumented build for
+     * \note The sketch must return from loop() regularly for the recording to be stopped gracefully
+     * \note Builds of sketches with the same contents take turns, across processes too; only the recorded profiles
+     *       outlive them
+     **/
+    std::error_code compile_pgo(Sketch& sketch, const BoardConfig& training_board,
+                                std::chrono::milliseconds training_duration) noexcept;
+
+    /**
+     * Compile a sketch on a worker thread
+     * \param sketch - sketch to compile
+     * \param log_sink - optional; invoked on the worker thread for each line of the build log
+     * \return handle to the compilation
+     **/
+    [[nodiscard]] CompileHandle compile_async(Sketch& sketch, LogSink log_sink = {}) noexcept;
 };
 
 } // namespace smce
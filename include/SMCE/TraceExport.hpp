@@ -0,0 +1,40 @@
+/*
+ *  TraceExport.hpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef LIBSMCE_TRACEEXPORT_HPP
+#define LIBSMCE_TRACEEXPORT_HPP
+
+#include <span>
+#include <system_error>
+#include "SMCE/BoardView.hpp"
+#include "SMCE/SMCE_fs.hpp"
+#include "SMCE/SMCE_iface.h"
+
+namespace smce {
+
+/**
+ * Writes trace events as a Chrome trace event JSON file, as loaded by chrome://tracing and ui.perfetto.dev
+ * \param events - events to write, as obtained from \ref smce::Tracing::events
+ * \param location - path of the file to write; its parent directories get created as needed
+ * \note The host and the board are laid out as two processes; timestamps are relative to the first event
+ **/
+SMCE_API std::error_code export_chrome_trace(std::span<const Tracing::Event> events, stdfs::path location) noexcept;
+
+} // namespace smce
+
+#endif // LIBSMCE_TRACEEXPORT_HPP
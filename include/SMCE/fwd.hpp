@@ -28,6 +28,8 @@ class BoardDeviceNativeSpecification;
 class BoardDeviceSyntheticSpecification;
 class BoardDeviceSpecification;
 class BoardDeviceView;
+class InputRecorder;
+class Netlist;
 class Sketch;
 class Toolchain;
 struct SketchConfig;
@@ -0,0 +1,87 @@
+/*
+ *  ApiCounters.hpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef SMCE_APICOUNTERS_HPP
+#define SMCE_APICOUNTERS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace smce {
+
+/// \internal
+// clang-format off
+enum struct ArdrivoApi : std::uint8_t {
+    digital_read,
+    digital_write,
+    analog_read,
+    analog_write,
+    serial_available,
+    serial_read,
+    serial_write,
+    file_read,
+    file_write,
+    mqtt_loop,
+    mqtt_publish,
+    camera_read_frame,
+};
+// clang-format on
+
+/// \internal
+constexpr std::array<std::string_view, 12> ardrivo_api_names{
+    "digitalRead", "digitalWrite", "analogRead", "analogWrite", "Serial.available", "Serial.read",
+    "Serial.write", "File::read",  "File::write", "MQTTClient::loop", "MQTTClient::publish", "OV767X::readFrame",
+};
+
+#if SMCE__API_COUNTERS
+
+/**
+ * \internal
+ * Accounts for one call to an Ardrivo entry point in the counters of the current thread
+ * \note Failures are picked up from the diagnostics raised while the scope is the innermost one
+ **/
+class ApiScope {
+    ArdrivoApi m_api;
+    ApiScope* m_parent;
+    bool m_failed = false;
+    std::chrono::steady_clock::time_point m_start;
+
+  public:
+    explicit ApiScope(ArdrivoApi api) noexcept;
+    ApiScope(const ApiScope&) = delete;
+    ApiScope& operator=(const ApiScope&) = delete;
+    ~ApiScope();
+
+    /// Marks the innermost scope of the current thread as failed
+    static void fail() noexcept;
+};
+
+/// \internal
+void flush_api_counters() noexcept;
+
+#    define SMCE__API_SCOPE(api) const ::smce::ApiScope smce__api_scope(::smce::ArdrivoApi::api)
+#else
+#    define SMCE__API_SCOPE(api) static_cast<void>(0)
+#endif
+
+} // namespace smce
+
+#endif // SMCE_APICOUNTERS_HPP
@@ -23,7 +23,6 @@
 #include <bit>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -46,7 +45,6 @@
 #include <boost/hana/tuple.hpp>
 #include <boost/hana/type.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
-#include <boost/interprocess/containers/deque.hpp>
 #include <boost/interprocess/containers/flat_map.hpp>
 #include <boost/interprocess/containers/string.hpp>
 #include <boost/interprocess/containers/vector.hpp>
@@ -59,6 +57,7 @@
 #include "SMCE/BoardDeviceFieldType.hpp"
 #include "SMCE/SMCE_iface.h"
 #include "SMCE/fwd.hpp"
+#include "SMCE/internal/ApiCounters.hpp"
 #include "SMCE_rt/SMCE_proxies.hpp"
 
 namespace smce {
@@ -110,6 +109,7 @@ using ShmBasicString = boost::interprocess::basic_string<T, std::char_traits<T>,
 using ShmString = ShmBasicString<char>;
 
 using StaticCharVec32 = boost::container::static_vector<char, 32>;
+using StaticCharVec64 = boost::container::static_vector<char, 64>;
 
 /**
  * Actual types described by VirtualDeviceField::Type
@@ -232,18 +232,33 @@ struct SMCE_INTERNAL BoardData {
         IpcAtomicValue<std::uint16_t> value = 0;                          // rw
         IpcAtomicValue<DataDirection> data_direction = DataDirection::in; // rw
         IpcAtomicValue<ActiveDriver> active_driver = ActiveDriver::gpio;  // rw
+        IpcAtomicValue<std::uint64_t> generation = 0;                     // rw; \see mark_changed
+    };
+    struct SMCE_INTERNAL UartBuffer {
+        IpcAtomicValue<std::uint64_t> head = 0;       // rw; \see ByteRing
+        IpcAtomicValue<std::uint64_t> tail = 0;       // rw
+        IpcAtomicValue<std::uint64_t> busy_until = 0; // rw
+        ShmVector<char> storage;                      // rw; sized to the capacity of the buffer
+        explicit UartBuffer(const ShmAllocator<void>&);
     };
     struct SMCE_INTERNAL UartChannel {
         IpcAtomicValue<bool> active = false; // rw
         IpcMovableMutex rx_mut;
         IpcMovableMutex tx_mut;
-        boost::interprocess::deque<char, ShmAllocator<char>> rx; // rw
-        boost::interprocess::deque<char, ShmAllocator<char>> tx; // rw
+        UartBuffer rx;
+        UartBuffer tx;
         std::uint16_t max_buffered_rx;                           // ro
         std::uint16_t max_buffered_tx;                           // ro
+        std::uint16_t flushing_threshold;                        // ro; bytes the sketch coalesces its writes into
+        bool flush_on_newline;                                   // ro
         std::uint16_t baud_rate;                                 // ro
+        std::uint64_t byte_time = 0;                             // ro; nanoseconds per byte when paced, else 0
         std::optional<std::uint16_t> rx_pin_override;            // ro
         std::optional<std::uint16_t> tx_pin_override;            // ro
+        StaticCharVec64 link;                                    // ro; segment of the UART link, if any
+        std::uint8_t link_side = 0;                              // ro; which end of the link this is
+        IpcAtomicValue<std::uint32_t> link_seq = 0;              // rw; odd while the link changes, \see set_uart_link
+        IpcAtomicValue<std::uint64_t> generation = 0;            // rw; \see mark_changed
         explicit UartChannel(const ShmAllocator<void>&);
     };
     struct SMCE_INTERNAL DirectStorage {
@@ -272,12 +287,13 @@ struct SMCE_INTERNAL BoardData {
             std::uint8_t vert_flip : 1 = false;
             std::uint8_t pixel_format : 6 = RGB888;
         };
-        std::size_t key;                          // ro
-        Direction direction;                      // ro
-        IpcAtomicValue<std::uint16_t> width = 0;  // rw
-        IpcAtomicValue<std::uint16_t> height = 0; // rw
-        IpcAtomicValue<std::uint8_t> freq = 0;    // rw
-        IpcAtomicValue<Transform> transform{};    // rw
+        std::size_t key;                              // ro
+        Direction direction;                          // ro
+        IpcAtomicValue<std::uint16_t> width = 0;      // rw
+        IpcAtomicValue<std::uint16_t> height = 0;     // rw
+        IpcAtomicValue<std::uint8_t> freq = 0;        // rw
+        IpcAtomicValue<Transform> transform{};        // rw
+        IpcAtomicValue<std::uint64_t> generation = 0; // rw; \see mark_changed
         IpcMovableMutex data_mut;
         ShmVector<std::byte> data; // rw
         explicit FrameBuffer(const ShmAllocator<void>&);
@@ -291,7 +307,62 @@ struct SMCE_INTERNAL BoardData {
         DeviceFieldBaseGroups bases;
     };
 
+    struct Diagnostic {
+        IpcAtomicValue<std::uint64_t> key = 0;         // rw; 0 for a free slot, claimed once by the board
+        IpcAtomicValue<bool> ready = false;            // rw; set once site and message have been written
+        IpcAtomicValue<std::uint64_t> count = 0;       // rw
+        IpcAtomicValue<std::int64_t> last_logged = 0; // rw; steady clock ticks (ns)
+        StaticCharVec64 site;
+        StaticCharVec64 message;
+    };
+    struct DroppedDiagnostic {
+        IpcAtomicValue<std::uint64_t> key = 0;         // rw; latest misuse left out of the table which hashed here
+        IpcAtomicValue<std::int64_t> last_logged = 0; // rw; steady clock ticks (ns)
+    };
+    constexpr static std::size_t diagnostics_capacity = 64;
+    struct LoopStats {
+        constexpr static std::size_t bucket_count = 40; // bucket i holds durations of bit width i, in ns
+        std::array<IpcAtomicValue<std::uint64_t>, bucket_count> buckets{}; // rw; single writer
+        IpcAtomicValue<std::uint64_t> iterations = 0;                      // rw; single writer
+        IpcAtomicValue<std::int64_t> total_ns = 0;                         // rw; single writer
+        IpcAtomicValue<std::int64_t> max_ns = 0;                           // rw; single writer
+        IpcAtomicValue<std::int64_t> setup_ns = -1;                        // rw; -1 until setup returns
+    };
+    struct ApiCounter {
+        IpcAtomicValue<std::uint64_t> calls = 0;    // rw
+        IpcAtomicValue<std::uint64_t> failures = 0; // rw
+        IpcAtomicValue<std::int64_t> total_ns = 0;  // rw
+    };
+    struct TraceRing {
+        struct Event {
+            IpcAtomicValue<std::uint64_t> seq = 0; // 0 while being written, index + 1 once complete
+            IpcAtomicValue<std::int64_t> ts_ns = 0;
+            IpcAtomicValue<std::uint64_t> arg = 0;
+            IpcAtomicValue<std::uint32_t> thread = 0;
+            IpcAtomicValue<std::uint8_t> phase = 0;
+            IpcAtomicValue<std::uint8_t> name_len = 0;
+            std::array<IpcAtomicValue<std::uint64_t>, 3> name{}; // packed chars
+        };
+        constexpr static std::size_t capacity = 2048;
+        IpcAtomicValue<std::uint64_t> head = 0; // rw; events ever claimed
+        std::array<Event, capacity> events;
+    };
+    struct LoopPacing {
+        // clang-format off
+        enum struct Policy {
+            free_run,
+            fixed_rate,
+            adaptive,
+        };
+        // clang-format on
+        Policy policy = Policy::free_run;
+        std::int64_t period_ns = 0;      // fixed_rate
+        std::int64_t max_backoff_ns = 0; // adaptive
+    };
+
     ShmVector<Pin> pins; // sorted by id
+    IpcAtomicValue<bool> pins_watched = false;           // rw; whether writes to pins get flagged in pins_dirty
+    ShmVector<IpcAtomicValue<std::uint64_t>> pins_dirty; // rw; bit i is set by writes to pins[i]
     ShmVector<UartChannel> uart_channels;
     ShmVector<DirectStorage> direct_storages;
     ShmVector<FrameBuffer> frame_buffers;
@@ -299,8 +370,44 @@ struct SMCE_INTERNAL BoardData {
     ShmFlatMap<StaticCharVec32, Device> device_map;
     DeviceFieldBanks banks;
 
+    std::array<Diagnostic, diagnostics_capacity> diagnostics; // open-addressed by key
+    IpcAtomicValue<std::uint64_t> diagnostics_dropped = 0;    // rw
+    std::array<DroppedDiagnostic, diagnostics_capacity> dropped_diagnostics; // by key; only rate-limit their logs
+
+    std::int64_t delay_spin_threshold_ns = 0; // ro
+    LoopPacing loop_pacing;                   // ro
+    IpcAtomicValue<double> loop_rate = 0;     // rw; iterations per second
+    LoopStats loop_stats;
+    std::array<ApiCounter, ardrivo_api_names.size()> api_counters; // indexed by ArdrivoApi
+    IpcAtomicValue<bool> tracing_enabled = false;                   // rw
+    ShmVector<TraceRing> trace_rings; // indexed by Tracing::Source; empty unless the board was configured with tracing
+
     IpcAtomicValue<bool> stop_requested = false; // rw
+    IpcAtomicValue<std::uint32_t> pending_events = 0; // rw; BoardEventBits raised since the host last took them
+    std::int32_t event_fd = -1;                        // ro; eventfd of the host, inherited by the sketch
+
+    IpcAtomicValue<std::uint64_t> generation = 1;      // rw; advanced by the host at each BoardView::changes_since
+    IpcAtomicValue<std::uint64_t> pins_generation = 0; // rw; \see mark_changed
+    std::array<IpcAtomicValue<std::uint64_t>, boost::hana::size(device_field_bank_types)> device_generations{}; // rw
+
     BoardData(const ShmAllocator<void>&, const BoardConfig&) noexcept;
+
+    /**
+     * Stamps a part of the board with the current generation, after the change has been made
+     * The generation is read again once stamped; if the host advanced it in between, the stamp is raised so that the
+     * change is reported by the next query instead of being missed by both
+     **/
+    void mark_changed(IpcAtomicValue<std::uint64_t>& stamp) noexcept {
+        const auto raise = [&](std::uint64_t value) {
+            auto seen = stamp.load();
+            while (seen < value && !stamp.compare_exchange_weak(seen, value))
+                ;
+        };
+        const auto current = generation.load();
+        raise(current);
+        if (const auto now = generation.load(); now != current)
+            raise(now);
+    }
 };
 
 } // namespace smce
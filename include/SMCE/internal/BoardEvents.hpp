@@ -0,0 +1,57 @@
+/*
+ *  BoardEvents.hpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef SMCE_BOARDEVENTS_HPP
+#define SMCE_BOARDEVENTS_HPP
+
+#include <cstdint>
+#include "SMCE/SMCE_iface.h"
+#include "SMCE/internal/BoardData.hpp"
+
+namespace smce {
+
+/// \internal Bits of BoardData::pending_events
+// clang-format off
+enum BoardEventBits : std::uint32_t {
+    uart_tx_event = 1 << 0,
+    pins_event = 1 << 1,
+    frame_buffers_event = 1 << 2,
+    devices_event = 1 << 3,
+    exited_event = 1 << 4,
+};
+// clang-format on
+
+/// \internal Set by Ardrivo; only the sketch raises events for what it does to the board
+SMCE_INTERNAL extern bool is_sketch_process;
+
+/**
+ * \internal
+ * Flags events as pending, waking up the host through the board's event descriptor if none were
+ * The host consumes the descriptor before taking the pending events, so no wake-up can get lost in between
+ **/
+SMCE_INTERNAL void raise_board_events(BoardData& bdat, std::uint32_t events) noexcept;
+
+/// \internal Raises events on behalf of the sketch; no-op in the host, which knows of its own writes
+inline void raise_sketch_events(BoardData& bdat, std::uint32_t events) noexcept {
+    if (is_sketch_process && (bdat.pending_events.load(boost::memory_order_relaxed) & events) != events)
+        raise_board_events(bdat, events);
+}
+
+} // namespace smce
+
+#endif // SMCE_BOARDEVENTS_HPP
@@ -0,0 +1,132 @@
+/*
+ *  ByteRing.hpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef SMCE_BYTERING_HPP
+#define SMCE_BYTERING_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include "SMCE/SMCE_iface.h"
+#include "SMCE/internal/BoardData.hpp"
+
+namespace smce {
+
+/**
+ * \internal
+ * View of a single-producer single-consumer byte ring laid out in shared memory
+ * Indices only ever grow; the producer owns `head`, the consumer owns `tail`. Spans handed out to either side stay
+ * valid until it commits or consumes them, as the other side never touches them in the meantime.
+ * A paced ring delivers bytes only once they would have made it over the wire: the producer keeps track of when the
+ * wire goes idle, from which the consumer works out how many of the held bytes are still in flight. Nothing runs in
+ * between, and unpaced rings never read the clock.
+ **/
+struct SMCE_INTERNAL ByteRing {
+    IpcAtomicValue<std::uint64_t>& head;
+    IpcAtomicValue<std::uint64_t>& tail;
+    std::span<char> storage;
+    std::size_t capacity; // bytes which may be held at once; at most the size of the storage
+    IpcAtomicValue<std::uint64_t>* busy_until = nullptr; // steady clock time at which the wire goes idle; producer side
+    std::uint64_t byte_time = 0;                         // nanoseconds a byte spends on the wire; 0 if not paced
+
+    /// Bytes delivered
+    [[nodiscard]] std::size_t size() const noexcept { return delivered(tail.load(boost::memory_order_acquire)); }
+
+    /// Bytes delivered, in order; consumer side
+    [[nodiscard]] std::array<std::span<char>, 2> readable() const noexcept {
+        const auto t = tail.load(boost::memory_order_relaxed);
+        return split(t, delivered(t));
+    }
+    void consume(std::size_t count) noexcept {
+        tail.store(tail.load(boost::memory_order_relaxed) + count, boost::memory_order_release);
+    }
+
+    /// Free space, up to `count` bytes; producer side
+    [[nodiscard]] std::array<std::span<char>, 2> writable(std::size_t count) const noexcept {
+        const auto h = head.load(boost::memory_order_relaxed);
+        const auto used = h - tail.load(boost::memory_order_acquire);
+        return split(h, std::min<std::size_t>(capacity - std::min<std::size_t>(used, capacity), count));
+    }
+    void commit(std::size_t count) noexcept {
+        if (byte_time && count) {
+            const auto idle = std::max(busy_until->load(boost::memory_order_relaxed), now());
+            busy_until->store(idle + count * byte_time, boost::memory_order_relaxed);
+        }
+        head.store(head.load(boost::memory_order_relaxed) + count, boost::memory_order_release);
+    }
+
+    /// Copies up to `buf.size()` bytes without consuming them
+    std::size_t peek(std::span<char> buf) const noexcept { return copy_out(readable(), buf); }
+    std::size_t read(std::span<char> buf) noexcept {
+        const auto count = peek(buf);
+        consume(count);
+        return count;
+    }
+    std::size_t write(std::span<const char> buf) noexcept {
+        const auto spans = writable(buf.size());
+        std::memcpy(spans[0].data(), buf.data(), spans[0].size());
+        std::memcpy(spans[1].data(), buf.data() + spans[0].size(), spans[1].size());
+        const auto count = spans[0].size() + spans[1].size();
+        commit(count);
+        return count;
+    }
+
+    /// Copies the contents of a pair of spans into a buffer, as far as it goes
+    static std::size_t copy_out(const std::array<std::span<char>, 2>& spans, std::span<char> buf) noexcept {
+        const auto first = std::min(spans[0].size(), buf.size());
+        const auto second = std::min(spans[1].size(), buf.size() - first);
+        std::memcpy(buf.data(), spans[0].data(), first);
+        std::memcpy(buf.data() + first, spans[1].data(), second);
+        return first + second;
+    }
+
+  private:
+    [[nodiscard]] static std::uint64_t now() noexcept {
+        const auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count();
+    }
+
+    /// Bytes held from index `from` which made it over the wire
+    [[nodiscard]] std::size_t delivered(std::uint64_t from) const noexcept {
+        const std::size_t held = head.load(boost::memory_order_acquire) - from;
+        if (!byte_time || !held)
+            return held;
+        // Held bytes went over the wire back to back, the last one finishing when it goes idle
+        const auto idle = busy_until->load(boost::memory_order_relaxed);
+        const auto time = now();
+        const auto in_flight = idle > time ? (idle - time + byte_time - 1) / byte_time : 0;
+        return held - std::min<std::size_t>(held, in_flight);
+    }
+
+    /// Storage holding `count` bytes from index `from`, split where it wraps around
+    [[nodiscard]] std::array<std::span<char>, 2> split(std::uint64_t from, std::size_t count) const noexcept {
+        if (storage.empty())
+            return {};
+        const std::size_t pos = from % storage.size();
+        const std::size_t first = std::min(count, storage.size() - pos);
+        return {storage.subspan(pos, first), storage.first(count - first)};
+    }
+};
+
+} // namespace smce
+
+#endif // SMCE_BYTERING_HPP
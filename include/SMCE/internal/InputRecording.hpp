@@ -0,0 +1,69 @@
+/*
+ *  InputRecording.hpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef SMCE_INTERNAL_INPUTRECORDING_HPP
+#define SMCE_INTERNAL_INPUTRECORDING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include "SMCE/SMCE_iface.h"
+#include "SMCE/fwd.hpp"
+
+namespace smce {
+
+/// \internal
+// clang-format off
+enum struct InputKind : std::uint8_t {
+    analog_write = 1,   // index: pin id, value: level
+    digital_write,      // index: pin id, value: level
+    pin_direction,      // index: pin id, value: direction
+    uart_rx_write,      // index: channel, payload: accepted bytes
+    framebuffer_rgb888, // index: key, value: width << 16 | height, payload: frame
+    framebuffer_rgb444, // index: key, value: width << 16 | height, payload: frame
+    device_store,       // index: bank, value: element, payload: element bytes
+};
+// clang-format on
+
+/// \internal
+struct InputEvent {
+    InputKind kind;
+    std::uint64_t index;
+    std::uint64_t value = 0;
+    std::span<const std::byte> payload = {};
+};
+
+/// \internal
+using InputHook = void (*)(const BoardData*, const InputEvent&) noexcept;
+
+/// \internal Installed by InputRecorder while it records at least one board of this process
+SMCE_INTERNAL extern std::atomic<InputHook> input_hook;
+
+/// \internal Whether any board of this process is being recorded
+inline bool recording_inputs() noexcept { return input_hook.load(std::memory_order_relaxed) != nullptr; }
+
+/// \internal Hands an input given to a board over to its recorder, if any
+inline void record_input(const BoardData* bdat, const InputEvent& event) noexcept {
+    if (const auto hook = input_hook.load(std::memory_order_relaxed))
+        hook(bdat, event);
+}
+
+} // namespace smce
+
+#endif // SMCE_INTERNAL_INPUTRECORDING_HPP
@@ -19,6 +19,9 @@
 #ifndef SMCE_SHAREDBOARDDATA_HPP
 #define SMCE_SHAREDBOARDDATA_HPP
 
+#include <span>
+#include <system_error>
+#include <vector>
 #include <boost/interprocess/managed_shared_memory.hpp>
 #include "SMCE/SMCE_iface.h"
 #include "SMCE/internal/BoardData.hpp"
@@ -31,6 +34,7 @@ class SMCE_INTERNAL SharedBoardData {
     std::string m_name;
     BoardData* m_bd = nullptr;
     bool m_master = false;
+    std::uint64_t m_config_hash = 0; // \see configure; part of the images of the board
 
   public:
     SharedBoardData() = default;
@@ -40,6 +44,14 @@ class SMCE_INTERNAL SharedBoardData {
     void reset();
 
     BoardData* get_board_data() noexcept { return m_bd; }
+    /// Size of the segment in bytes; 0 if none is mapped
+    std::size_t segment_size() noexcept { return m_bd ? m_shm.get_size() : 0; }
+    /// Bytes of the segment still available to its allocator; 0 if none is mapped
+    std::size_t segment_free() noexcept { return m_bd ? m_shm.get_free_memory() : 0; }
+    /// \see Board::snapshot
+    std::error_code save_image(std::vector<std::byte>& image);
+    /// \see Board::restore
+    std::error_code load_image(std::span<const std::byte> image);
 };
 
 } // namespace smce
@@ -0,0 +1,92 @@
+/*
+ *  UartLink.hpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef SMCE_UARTLINK_HPP
+#define SMCE_UARTLINK_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include "SMCE/SMCE_iface.h"
+#include "SMCE/internal/BoardData.hpp"
+#include "SMCE/internal/ByteRing.hpp"
+
+namespace smce {
+
+/**
+ * \internal
+ * Byte ring carrying one direction of a UART link
+ **/
+struct SMCE_INTERNAL UartLinkRing {
+    constexpr static std::size_t storage_size = 64 * 1024; // above any max_buffered value
+
+    alignas(64) IpcAtomicValue<std::uint64_t> head = 0;
+    IpcAtomicValue<std::uint64_t> busy_until = 0; // \see ByteRing::byte_time
+    alignas(64) IpcAtomicValue<std::uint64_t> tail = 0;
+    std::uint32_t capacity = 0;  // ro; bytes which may be in flight at once
+    std::uint64_t byte_time = 0; // ro; shared by both ends of the link, \see ByteRing::byte_time
+    std::array<char, storage_size> storage;
+
+    [[nodiscard]] ByteRing view() noexcept { return {head, tail, storage, capacity, &busy_until, byte_time}; }
+};
+
+/**
+ * \internal
+ * Shared segment cross-connecting the UART channels of two boards
+ * Channel side `s` transmits into `rings[s]` and receives from `rings[1 - s]`
+ **/
+struct SMCE_INTERNAL UartLinkData {
+    std::array<UartLinkRing, 2> rings;
+};
+
+/**
+ * \internal
+ * Creates a link segment and registers it in this process
+ * \param capacities - capacity of each ring; clamped to the ring storage
+ * \param byte_time - pacing of both rings; 0 for none
+ **/
+SMCE_INTERNAL std::shared_ptr<UartLinkData>
+create_uart_link(std::string_view name, std::array<std::size_t, 2> capacities, std::uint64_t byte_time) noexcept;
+
+/**
+ * \internal
+ * Connects a channel to a link segment, or disconnects it given an empty name
+ * The host may do so while the sketch runs; `link_seq` turns odd for the duration of the rewrite, so that lookups
+ * racing with it see a torn link as no link
+ **/
+SMCE_INTERNAL void set_uart_link(BoardData::UartChannel& chan, std::string_view name, std::uint8_t side) noexcept;
+
+/**
+ * \internal
+ * Link segment a channel is connected to, mapped on first use in this process
+ * Served from a small per-thread cache keyed by the channel, which keeps the mapping alive
+ * \param side - receives which end of the link the channel is
+ * \return null if the channel is not linked, is being linked or disconnected, or its segment is gone; valid until
+ *         the same thread has looked up the links of four other channels since
+ **/
+SMCE_INTERNAL UartLinkData* find_uart_link(const BoardData::UartChannel& chan, std::uint8_t& side) noexcept;
+
+/// \internal Unmaps a link segment from this process and removes its name; live mappings of other processes remain
+SMCE_INTERNAL void release_uart_link(std::string_view name) noexcept;
+
+} // namespace smce
+
+#endif // SMCE_UARTLINK_HPP
@@ -27,9 +27,10 @@ struct Impl;
 
 class SMCE_PROXY_API AtomicU8 {
     void* m_ptr{};
+    void* m_board{}; // board the field belongs to, stamped on stores
 
   public:
-    AtomicU8(void* ptr, const Impl&) noexcept : m_ptr{ptr} {}
+    AtomicU8(void* ptr, void* board, const Impl&) noexcept : m_ptr{ptr}, m_board{board} {}
     AtomicU8() noexcept = default;
     AtomicU8(AtomicU8&) = delete;
     inline AtomicU8(AtomicU8&&) noexcept = default;
@@ -43,9 +44,10 @@ class SMCE_PROXY_API AtomicU8 {
 
 class SMCE_PROXY_API AtomicU16 {
     void* m_ptr{};
+    void* m_board{}; // board the field belongs to, stamped on stores
 
   public:
-    AtomicU16(void* ptr, const Impl&) noexcept : m_ptr{ptr} {}
+    AtomicU16(void* ptr, void* board, const Impl&) noexcept : m_ptr{ptr}, m_board{board} {}
     AtomicU16() noexcept = default;
     AtomicU16(AtomicU16&) = delete;
     inline AtomicU16(AtomicU16&&) noexcept = default;
@@ -59,9 +61,10 @@ class SMCE_PROXY_API AtomicU16 {
 
 class SMCE_PROXY_API AtomicU32 {
     void* m_ptr{};
+    void* m_board{}; // board the field belongs to, stamped on stores
 
   public:
-    AtomicU32(void* ptr, const Impl&) noexcept : m_ptr{ptr} {}
+    AtomicU32(void* ptr, void* board, const Impl&) noexcept : m_ptr{ptr}, m_board{board} {}
     AtomicU32() noexcept = default;
     AtomicU32(AtomicU32&) = delete;
     inline AtomicU32(AtomicU32&&) noexcept = default;
@@ -75,9 +78,10 @@ class SMCE_PROXY_API AtomicU32 {
 
 class SMCE_PROXY_API AtomicU64 {
     void* m_ptr{};
+    void* m_board{}; // board the field belongs to, stamped on stores
 
   public:
-    AtomicU64(void* ptr, const Impl&) noexcept : m_ptr{ptr} {}
+    AtomicU64(void* ptr, void* board, const Impl&) noexcept : m_ptr{ptr}, m_board{board} {}
     AtomicU64() noexcept = default;
     AtomicU64(AtomicU64&) = delete;
     inline AtomicU64(AtomicU64&&) noexcept = default;
@@ -93,7 +97,7 @@ class SMCE_PROXY_API AtomicS8 {
     AtomicU8 m_u{};
 
   public:
-    AtomicS8(void* ptr, const Impl& impl) noexcept : m_u{ptr, impl} {}
+    AtomicS8(void* ptr, void* board, const Impl& impl) noexcept : m_u{ptr, board, impl} {}
     AtomicS8() noexcept = default;
     AtomicS8(AtomicS8&) = delete;
     inline AtomicS8(AtomicS8&&) noexcept = default;
@@ -109,7 +113,7 @@ class SMCE_PROXY_API AtomicS16 {
     AtomicU16 m_u{};
 
   public:
-    AtomicS16(void* ptr, const Impl& impl) noexcept : m_u{ptr, impl} {}
+    AtomicS16(void* ptr, void* board, const Impl& impl) noexcept : m_u{ptr, board, impl} {}
     AtomicS16() noexcept = default;
     AtomicS16(AtomicS16&) = delete;
     inline AtomicS16(AtomicS16&&) noexcept = default;
@@ -125,7 +129,7 @@ class SMCE_PROXY_API AtomicS32 {
     AtomicU32 m_u{};
 
   public:
-    AtomicS32(void* ptr, const Impl& impl) noexcept : m_u{ptr, impl} {}
+    AtomicS32(void* ptr, void* board, const Impl& impl) noexcept : m_u{ptr, board, impl} {}
     AtomicS32() noexcept = default;
     AtomicS32(AtomicS32&) = delete;
     inline AtomicS32(AtomicS32&&) noexcept = default;
@@ -141,7 +145,7 @@ class SMCE_PROXY_API AtomicS64 {
     AtomicU64 m_u{};
 
   public:
-    AtomicS64(void* ptr, const Impl& impl) noexcept : m_u{ptr, impl} {}
+    AtomicS64(void* ptr, void* board, const Impl& impl) noexcept : m_u{ptr, board, impl} {}
     AtomicS64() noexcept = default;
     AtomicS64(AtomicS64&) = delete;
     inline AtomicS64(AtomicS64&&) noexcept = default;
@@ -155,9 +159,10 @@ class SMCE_PROXY_API AtomicS64 {
 
 class SMCE_PROXY_API AtomicF32 {
     void* m_ptr{};
+    void* m_board{}; // board the field belongs to, stamped on stores
 
   public:
-    AtomicF32(void* ptr, const Impl&) noexcept : m_ptr{ptr} {}
+    AtomicF32(void* ptr, void* board, const Impl&) noexcept : m_ptr{ptr}, m_board{board} {}
     AtomicF32() noexcept = default;
     AtomicF32(AtomicF32&) = delete;
     inline AtomicF32(AtomicF32&&) noexcept = default;
@@ -171,9 +176,10 @@ class SMCE_PROXY_API AtomicF32 {
 
 class SMCE_PROXY_API AtomicF64 {
     void* m_ptr{};
+    void* m_board{}; // board the field belongs to, stamped on stores
 
   public:
-    AtomicF64(void* ptr, const Impl&) noexcept : m_ptr{ptr} {}
+    AtomicF64(void* ptr, void* board, const Impl&) noexcept : m_ptr{ptr}, m_board{board} {}
     AtomicF64() noexcept = default;
     AtomicF64(AtomicF64&) = delete;
     inline AtomicF64(AtomicF64&&) noexcept = default;
@@ -16,40 +16,60 @@
  *
  */
 
+#include <cerrno>
 #include <chrono>
+#include <ctime>
 #include <iostream>
+#include <string_view>
 #include <thread>
+#include <vector>
+#include <boost/predef.h>
 #include "Ardrivo/Arduino.h"
 #include "SMCE/BoardView.hpp"
+#include "SMCE/internal/ApiCounters.hpp"
 
 namespace smce {
 extern BoardView board_view;
-extern void maybe_init();
+extern std::vector<VirtualPin> pin_views;
+extern std::chrono::nanoseconds delay_spin_threshold;
+extern std::uint64_t io_activity;
+void precise_sleep_until(std::chrono::steady_clock::time_point deadline) noexcept;
+void flush_serial(bool only_if_due) noexcept;
+extern std::uint64_t diagnostic_due(std::string_view site, std::string_view message) noexcept;
 } // namespace smce
 
 using namespace smce;
 
+/// \note Only writes count as I/O activity for loop pacing; polling a pin whose value did not change is idling
+static VirtualPin pin_view(int pin) noexcept {
+    const auto id = static_cast<std::size_t>(pin);
+    return id < pin_views.size() ? pin_views[id] : board_view.pins[id];
+}
+
 void pinMode(int pin, bool mode) {
     auto error = [=](const char* msg) {
-        std::cerr << "ERROR: pinMode(" << pin << ", " << (mode ? "OUTPUT" : "INPUT") << "): " << msg << std::endl;
+        if (diagnostic_due("pinMode", msg))
+            std::cerr << "ERROR: pinMode(" << pin << ", " << (mode ? "OUTPUT" : "INPUT") << "): " << msg << '\n';
     };
-    maybe_init();
-    auto vpin = board_view.pins[pin];
+    auto vpin = pin_view(pin);
 
     if (!vpin.exists())
         return error("Pin does not exist");
     if (vpin.locked())
         return error("Pin is in use by another device");
 
+    ++io_activity;
     vpin.set_direction(static_cast<VirtualPin::DataDirection>(+mode));
 }
 
 int digitalRead(int pin) {
+    SMCE__API_SCOPE(digital_read);
     auto error = [=](const char* msg) {
-        return std::cerr << "ERROR: digitalRead(" << pin << "): " << msg << std::endl, 0;
+        if (diagnostic_due("digitalRead", msg))
+            std::cerr << "ERROR: digitalRead(" << pin << "): " << msg << '\n';
+        return 0;
     };
-    maybe_init();
-    auto vpin = board_view.pins[pin];
+    auto vpin = pin_view(pin);
 
     if (!vpin.exists())
         return error("Pin does not exist");
@@ -64,11 +84,12 @@ int digitalRead(int pin) {
 }
 
 void digitalWrite(int pin, bool value) {
+    SMCE__API_SCOPE(digital_write);
     auto error = [=](const char* msg) {
-        std::cerr << "ERROR: digitalWrite(" << pin << ", " << (value ? "HIGH" : "LOW") << "): " << msg << std::endl;
+        if (diagnostic_due("digitalWrite", msg))
+            std::cerr << "ERROR: digitalWrite(" << pin << ", " << (value ? "HIGH" : "LOW") << "): " << msg << '\n';
     };
-    maybe_init();
-    auto vpin = board_view.pins[pin];
+    auto vpin = pin_view(pin);
 
     if (!vpin.exists())
         return error("Pin does not exist");
@@ -79,15 +100,18 @@ void digitalWrite(int pin, bool value) {
     if (vpin.get_direction() != VirtualPin::DataDirection::out)
         return error("Pin is in input mode");
 
+    ++io_activity;
     vpin.digital().write(value);
 }
 
 int analogRead(int pin) {
+    SMCE__API_SCOPE(analog_read);
     auto error = [=](const char* msg) {
-        return std::cerr << "ERROR: analogRead(" << pin << "): " << msg << std::endl, 0;
+        if (diagnostic_due("analogRead", msg))
+            std::cerr << "ERROR: analogRead(" << pin << "): " << msg << '\n';
+        return 0;
     };
-    maybe_init();
-    auto vpin = board_view.pins[pin];
+    auto vpin = pin_view(pin);
 
     if (!vpin.exists())
         return error("Pin does not exist");
@@ -102,11 +126,12 @@ int analogRead(int pin) {
 }
 
 void analogWrite(int pin, byte value) {
+    SMCE__API_SCOPE(analog_write);
     auto error = [=](const char* msg) {
-        std::cerr << "ERROR: analogWrite(" << pin << ", " << static_cast<int>(value) << "): " << msg << std::endl;
+        if (diagnostic_due("analogWrite", msg))
+            std::cerr << "ERROR: analogWrite(" << pin << ", " << static_cast<int>(value) << "): " << msg << '\n';
     };
-    maybe_init();
-    auto vpin = board_view.pins[pin];
+    auto vpin = pin_view(pin);
 
     if (!vpin.exists())
         return error("Pin does not exist");
@@ -117,12 +142,44 @@ void analogWrite(int pin, byte value) {
     if (vpin.get_direction() != VirtualPin::DataDirection::out)
         return error("Pin is in input mode");
 
+    ++io_activity;
     vpin.analog().write(value);
 }
 
-void delay(unsigned long long ms) { std::this_thread::sleep_for(std::chrono::milliseconds{ms}); }
+/// Sleeps through the bulk of the interval, then spins through the board's delay spin threshold
+void smce::precise_sleep_until(std::chrono::steady_clock::time_point deadline) noexcept {
+    // A sleeping sketch writes nothing more its coalesced bytes could wait for
+    flush_serial(false);
+    const auto wake_up = deadline - delay_spin_threshold;
+#if BOOST_OS_LINUX
+    // Absolute deadlines do not accumulate the latency of being woken up early by a signal
+    const auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(wake_up.time_since_epoch());
+    const auto secs = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    timespec ts{};
+    ts.tv_sec = static_cast<std::time_t>(secs.count());
+    ts.tv_nsec = static_cast<long>((since_epoch - secs).count());
+    while (::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+        ;
+#else
+    std::this_thread::sleep_until(wake_up);
+#endif
+    while (std::chrono::steady_clock::now() < deadline)
+        ;
+}
+
+/// Point in time `count` units from now, saturated instead of overflowing for the longest delays
+template <class Unit>
+static std::chrono::steady_clock::time_point deadline_in(unsigned long long count) noexcept {
+    const auto now = std::chrono::steady_clock::now();
+    const auto room = std::chrono::duration_cast<Unit>(std::chrono::steady_clock::time_point::max() - now);
+    if (count >= static_cast<unsigned long long>(room.count()))
+        return std::chrono::steady_clock::time_point::max();
+    return now + Unit{static_cast<typename Unit::rep>(count)};
+}
+
+void delay(unsigned long long ms) { precise_sleep_until(deadline_in<std::chrono::milliseconds>(ms)); }
 
-void delayMicroseconds(unsigned long long us) { std::this_thread::sleep_for(std::chrono::microseconds{us}); }
+void delayMicroseconds(unsigned long long us) { precise_sleep_until(deadline_in<std::chrono::microseconds>(us)); }
 
 static const auto start_time = std::chrono::steady_clock::now();
 
@@ -16,31 +16,109 @@
  *
  */
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <limits>
+#include <span>
+#include <string_view>
+#include <vector>
 #include <SMCE/BoardView.hpp>
+#include <SMCE/internal/ApiCounters.hpp>
 #include "HardwareSerial.h"
 #include "SMCE_dll.hpp"
 
 namespace smce {
 extern BoardView board_view;
-extern void maybe_init();
+extern std::uint64_t io_activity;
+extern std::size_t serial_flushing_threshold;
+extern bool serial_flush_on_newline;
+extern std::uint64_t diagnostic_due(std::string_view site, std::string_view message) noexcept;
+extern void diagnose(std::string_view site, std::string_view message) noexcept;
 } // namespace smce
 
 using namespace smce;
 
+/// Time written bytes may wait in the coalescing buffer before getting published regardless
+constexpr auto coalescing_timeout = std::chrono::milliseconds{5};
+
 struct SMCE_HardwareSerialImpl : HardwareSerial {
     explicit SMCE_HardwareSerialImpl(int id) noexcept : m_id{id} {}
     const int m_id;
-    VirtualUart view() noexcept {
-        maybe_init();
-        return board_view.uart_channels[m_id];
+    std::vector<char> m_pending; // written bytes not yet published to the tx buffer, when coalescing
+    std::chrono::steady_clock::time_point m_pending_since;
+
+    /// \note Polling does not count as I/O activity for loop pacing, only bytes actually written or read do
+    VirtualUart view() noexcept { return board_view.uart_channels[m_id]; }
+
+    /// Moves as many pending bytes as fit into the tx buffer
+    void publish() noexcept {
+        if (m_pending.empty())
+            return;
+        const auto count = view().tx().write(m_pending);
+        m_pending.erase(m_pending.begin(), m_pending.begin() + static_cast<std::ptrdiff_t>(count));
+        m_pending_since = std::chrono::steady_clock::now();
+    }
+
+    /// Publishes pending bytes which have waited long enough
+    void publish_if_due() noexcept {
+        if (!m_pending.empty() && std::chrono::steady_clock::now() - m_pending_since >= coalescing_timeout)
+            publish();
+    }
+
+    /**
+     * Buffers bytes until there are enough of them to be worth publishing at once
+     * \return number of bytes taken, less than that of `buf` only if the tx buffer is full
+     **/
+    std::size_t coalesce(std::span<const char> buf) noexcept try {
+        if (m_pending.empty())
+            m_pending_since = std::chrono::steady_clock::now();
+        std::size_t taken = 0;
+        while (taken < buf.size()) {
+            if (m_pending.size() >= serial_flushing_threshold) {
+                publish();
+                if (m_pending.size() >= serial_flushing_threshold)
+                    break;
+            }
+            auto chunk = buf.subspan(taken).first(
+                std::min(buf.size() - taken, serial_flushing_threshold - m_pending.size()));
+            // Only the bytes up to the end of the line go out with it
+            const auto eol = serial_flush_on_newline ? std::find(chunk.begin(), chunk.end(), '\n') : chunk.end();
+            const bool line_ended = eol != chunk.end();
+            if (line_ended)
+                chunk = chunk.first(static_cast<std::size_t>(eol - chunk.begin()) + 1);
+            m_pending.insert(m_pending.end(), chunk.begin(), chunk.end());
+            taken += chunk.size();
+            if (line_ended)
+                publish();
+        }
+        if (m_pending.size() >= serial_flushing_threshold)
+            publish();
+        publish_if_due();
+        return taken;
+    } catch (const std::bad_alloc&) {
+        publish();
+        return view().tx().write(buf);
+    }
+
+    std::size_t write(std::span<const char> buf) noexcept {
+        const auto count = serial_flushing_threshold ? coalesce(buf) : view().tx().write(buf);
+        if (count)
+            ++io_activity;
+        return count;
     }
 };
 
 SMCE_HardwareSerialImpl Serial_impl{0};
 SMCE__DLL_API HardwareSerial& Serial{Serial_impl};
 
+namespace smce {
+/// Publishes the bytes held back by the coalescing of Serial; all of them, or only those which waited long enough
+void flush_serial(bool only_if_due) noexcept {
+    only_if_due ? Serial_impl.publish_if_due() : Serial_impl.publish();
+}
+} // namespace smce
+
 constexpr SMCE_HardwareSerialImpl& upcast(HardwareSerial& obj) {
     return static_cast<SMCE_HardwareSerialImpl&>(obj); // NOLINT
 }
@@ -51,48 +129,65 @@ void HardwareSerial::begin([[maybe_unused]] unsigned long baud_rate, [[maybe_unu
 
 void HardwareSerial::end() {
     if (!upcast(*this).view().is_active())
-        return (void)(std::cerr << "HardwareSerial::end(): Already inactive" << std::endl);
+        return (void)(diagnose("HardwareSerial::end", "Already inactive"));
+    upcast(*this).publish();
+    upcast(*this).m_pending.clear();
     upcast(*this).view().set_active(false);
 }
 
 int HardwareSerial::available() {
+    SMCE__API_SCOPE(serial_available);
     if (!upcast(*this).view().is_active())
-        return std::cerr << "HardwareSerial::available(): Device inactive" << std::endl, 0;
+        return diagnose("HardwareSerial::available", "Device inactive"), 0;
+    upcast(*this).publish_if_due();
     return static_cast<int>(upcast(*this).view().rx().size());
 }
 
 int HardwareSerial::availableForWrite() {
     if (!upcast(*this).view().is_active())
-        return std::cerr << "HardwareSerial::availableForWrite(): Device inactive" << std::endl, 0;
-    auto tx_buf = upcast(*this).view().tx();
-    return static_cast<int>(tx_buf.max_size() - tx_buf.size());
+        return diagnose("HardwareSerial::availableForWrite", "Device inactive"), 0;
+    // Bytes still going over the wire of a paced channel hold on to their room
+    const auto room = upcast(*this).view().tx().prepare(std::numeric_limits<std::size_t>::max());
+    const auto free = room[0].size() + room[1].size();
+    return static_cast<int>(free - std::min(free, upcast(*this).m_pending.size()));
 }
 
 size_t HardwareSerial::write(uint8_t c) {
+    SMCE__API_SCOPE(serial_write);
     if (!upcast(*this).view().is_active())
-        return std::cerr << "HardwareSerial::write(" << static_cast<int>(c) << "): Device inactive" << std::endl, 0;
-    return upcast(*this).view().tx().write({reinterpret_cast<const char*>(&c), 1});
+        return diagnose("HardwareSerial::write(c)", "Device inactive"), 0;
+    return upcast(*this).write({reinterpret_cast<const char*>(&c), 1});
 }
 
 size_t HardwareSerial::write(const uint8_t* buf, std::size_t n) {
+    SMCE__API_SCOPE(serial_write);
     if (!upcast(*this).view().is_active())
-        return std::cerr << "HardwareSerial::write(?, " << n << "): Device inactive" << std::endl, 0;
-    return upcast(*this).view().tx().write({reinterpret_cast<const char*>(buf), n});
+        return diagnose("HardwareSerial::write(buf, n)", "Device inactive"), 0;
+    return upcast(*this).write({reinterpret_cast<const char*>(buf), n});
+}
+
+void HardwareSerial::flush() {
+    if (!upcast(*this).view().is_active())
+        return (void)(diagnose("HardwareSerial::flush", "Device inactive"));
+    upcast(*this).publish();
 }
 
 int HardwareSerial::peek() {
     if (!upcast(*this).view().is_active())
-        return std::cerr << "HardwareSerial::peek(): Device inactive" << std::endl, -1;
+        return diagnose("HardwareSerial::peek", "Device inactive"), -1;
     if (upcast(*this).view().rx().size() < 1)
         return -1;
     return upcast(*this).view().rx().front();
 }
 
 int HardwareSerial::read() {
+    SMCE__API_SCOPE(serial_read);
     if (!upcast(*this).view().is_active())
-        return std::cerr << "HardwareSerial::read(): Device inactive" << std::endl, -1;
+        return diagnose("HardwareSerial::read", "Device inactive"), -1;
+    upcast(*this).publish_if_due();
     char ret;
-    if (upcast(*this).view().rx().read({&ret, 1}))
-        return ret;
-    return -1;
+    if (!upcast(*this).view().rx().read({&ret, 1}))
+        return -1;
+    ++io_activity;
+    return ret;
 }
\ No newline at end of file
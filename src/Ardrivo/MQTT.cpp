@@ -20,6 +20,7 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <SMCE/internal/ApiCounters.hpp>
 #include "MQTT.h"
 
 #include <mosquitto.h>
@@ -118,6 +119,7 @@ bool MQTTClient::connect(const char* clientID, const char* username, const char*
 }
 
 bool MQTTClient::publish(const char* topic, const char* payload, int length, bool retained, int qos) {
+    SMCE__API_SCOPE(mqtt_publish);
     return ::mosquitto_publish(static_cast<Mosquitto*>(m_client), nullptr, topic, length, payload, qos, retained) ==
            MOSQ_ERR_SUCCESS;
 }
@@ -130,6 +132,9 @@ bool MQTTClient::unsubscribe(const char* topic) {
     return ::mosquitto_unsubscribe(static_cast<Mosquitto*>(m_client), nullptr, topic) == MOSQ_ERR_SUCCESS;
 }
 
-bool MQTTClient::loop() { return mosquitto_loop(static_cast<Mosquitto*>(m_client), 0, 1024) == MOSQ_ERR_SUCCESS; }
+bool MQTTClient::loop() {
+    SMCE__API_SCOPE(mqtt_loop);
+    return mosquitto_loop(static_cast<Mosquitto*>(m_client), 0, 1024) == MOSQ_ERR_SUCCESS;
+}
 bool MQTTClient::connected() { return m_client && mosquitto_socket(static_cast<Mosquitto*>(m_client)) != -1; }
 bool MQTTClient::disconnect() { return mosquitto_disconnect(static_cast<Mosquitto*>(m_client)) == MOSQ_ERR_SUCCESS; }
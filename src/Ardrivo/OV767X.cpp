@@ -19,15 +19,26 @@
 #include <array>
 #include <climits>
 #include <iostream>
+#include <string_view>
 #include <utility>
+#include <vector>
 #include <SMCE/BoardView.hpp>
+#include <SMCE/internal/ApiCounters.hpp>
 #include "OV767X.h"
 
 namespace smce {
 extern BoardView board_view;
-extern void maybe_init();
+extern std::vector<FrameBuffer> frame_buffer_views;
+extern std::uint64_t io_activity;
+extern std::uint64_t diagnostic_due(std::string_view site, std::string_view message) noexcept;
+extern void diagnose(std::string_view site, std::string_view message) noexcept;
 } // namespace smce
 
+static smce::FrameBuffer frame_buffer(std::size_t key) noexcept {
+    ++smce::io_activity;
+    return key < smce::frame_buffer_views.size() ? smce::frame_buffer_views[key] : smce::board_view.frame_buffers[key];
+}
+
 SMCE__DLL_API OV767X Camera;
 
 OV767X::OV767X() noexcept : m_format{RGB888} {
@@ -63,12 +74,12 @@ constexpr static std::array<std::pair<uint16_t, uint16_t>, 5> resolutions{{
 
 int OV767X::begin(SMCE_OV767_Resolution resolution, SMCE_OV767_Format format, int fps) {
     const auto error = [=](const char* msg) {
-        std::cerr << "ERROR: OV767X::begin(" << resolution << ", " << format << ", " << fps << "): " << msg
-                  << std::endl;
+        if (smce::diagnostic_due("OV767X::begin", msg))
+            std::cerr << "ERROR: OV767X::begin(" << resolution << ", " << format << ", " << fps << "): " << msg << '\n';
         return -1;
     };
     if (m_begun) {
-        std::cerr << "OV767X::begin: device already active" << std::endl;
+        smce::diagnose("OV767X::begin", "device already active");
         return -1;
     }
     switch (format) {
@@ -83,7 +94,7 @@ int OV767X::begin(SMCE_OV767_Resolution resolution, SMCE_OV767_Format format, in
     if (resolution >= resolutions.size())
         return error("Unknown resolution");
 
-    auto fb = smce::board_view.frame_buffers[m_key];
+    auto fb = frame_buffer(m_key);
     if (!fb.exists())
         return error("Framebuffer does not exist");
     if (fb.direction() != smce::FrameBuffer::Direction::in)
@@ -99,10 +110,10 @@ int OV767X::begin(SMCE_OV767_Resolution resolution, SMCE_OV767_Format format, in
 
 void OV767X::end() {
     if (!m_begun) {
-        std::cerr << "OV767X::end: device inactive" << std::endl;
+        smce::diagnose("OV767X::end", "device inactive");
         return;
     }
-    auto fb = smce::board_view.frame_buffers[m_key];
+    auto fb = frame_buffer(m_key);
     fb.set_width(0);
     fb.set_height(0);
     fb.set_freq(0);
@@ -111,25 +122,25 @@ void OV767X::end() {
 
 int OV767X::width() const {
     if (!m_begun) {
-        std::cerr << "OV767X::width: device inactive" << std::endl;
+        smce::diagnose("OV767X::width", "device inactive");
         return 0;
     }
-    return smce::board_view.frame_buffers[m_key].get_width();
+    return frame_buffer(m_key).get_width();
 }
 
 int OV767X::height() const {
     if (!m_begun) {
-        std::cerr << "OV767X::height: device inactive" << std::endl;
+        smce::diagnose("OV767X::height", "device inactive");
         return 0;
     }
-    return smce::board_view.frame_buffers[m_key].get_height();
+    return frame_buffer(m_key).get_height();
 }
 
 constexpr std::array<std::pair<int, int>, 2> bits_bytes_pixel_formats{{{24, 3}, {16, 2}}};
 
 int OV767X::bitsPerPixel() const {
     if (!m_begun) {
-        std::cerr << "OV767X::bitsPerPixel: device inactive" << std::endl;
+        smce::diagnose("OV767X::bitsPerPixel", "device inactive");
         return 0;
     }
     return bits_bytes_pixel_formats[m_format].first;
@@ -137,15 +148,16 @@ int OV767X::bitsPerPixel() const {
 
 int OV767X::bytesPerPixel() const {
     if (!m_begun) {
-        std::cerr << "OV767X::bytesPerPixel: device inactive" << std::endl;
+        smce::diagnose("OV767X::bytesPerPixel", "device inactive");
         return 0;
     }
     return bits_bytes_pixel_formats[m_format].second;
 }
 
 void OV767X::readFrame(void* buffer) {
+    SMCE__API_SCOPE(camera_read_frame);
     if (!m_begun) {
-        std::cerr << "OV767X::readFrame: device inactive" << std::endl;
+        smce::diagnose("OV767X::readFrame", "device inactive");
         return;
     }
     using ReadType = std::add_const_t<decltype(&smce::FrameBuffer::read_rgb888)>;
@@ -153,38 +165,38 @@ void OV767X::readFrame(void* buffer) {
         &smce::FrameBuffer::read_rgb888,
         &smce::FrameBuffer::read_rgb444,
     };
-    (smce::board_view.frame_buffers[m_key].*format_read[m_format])(
+    (frame_buffer(m_key).*format_read[m_format])(
         {static_cast<std::byte*>(buffer), static_cast<std::size_t>(bitsPerPixel() * width() * height() / CHAR_BIT)});
 }
 
 void OV767X::horizontalFlip() {
     if (!m_begun) {
-        std::cerr << "OV767X::horizontalFlip: device inactive" << std::endl;
+        smce::diagnose("OV767X::horizontalFlip", "device inactive");
         return;
     }
-    smce::board_view.frame_buffers[m_key].needs_horizontal_flip(true);
+    frame_buffer(m_key).needs_horizontal_flip(true);
 }
 
 void OV767X::noHorizontalFlip() {
     if (!m_begun) {
-        std::cerr << "OV767X::noHorizontalFlip: device inactive" << std::endl;
+        smce::diagnose("OV767X::noHorizontalFlip", "device inactive");
         return;
     }
-    smce::board_view.frame_buffers[m_key].needs_horizontal_flip(false);
+    frame_buffer(m_key).needs_horizontal_flip(false);
 }
 
 void OV767X::verticalFlip() {
     if (!m_begun) {
-        std::cerr << "OV767X::verticalFlip: device inactive" << std::endl;
+        smce::diagnose("OV767X::verticalFlip", "device inactive");
         return;
     }
-    smce::board_view.frame_buffers[m_key].needs_vertical_flip(true);
+    frame_buffer(m_key).needs_vertical_flip(true);
 }
 
 void OV767X::noVerticalFlip() {
     if (!m_begun) {
-        std::cerr << "OV767X::noVerticalFlip: device inactive" << std::endl;
+        smce::diagnose("OV767X::noVerticalFlip", "device inactive");
         return;
     }
-    smce::board_view.frame_buffers[m_key].needs_vertical_flip(false);
+    frame_buffer(m_key).needs_vertical_flip(false);
 }
@@ -23,12 +23,15 @@
 #include <string_view>
 #include <variant>
 #include <SMCE/BoardView.hpp>
+#include <SMCE/internal/ApiCounters.hpp>
 #include "SD.h"
 #include "SMCE_dll.hpp"
 
 namespace smce {
 extern BoardView board_view;
-extern void maybe_init();
+extern std::uint64_t io_activity;
+extern std::uint64_t diagnostic_due(std::string_view site, std::string_view message) noexcept;
+extern void diagnose(std::string_view site, std::string_view message) noexcept;
 } // namespace smce
 
 using namespace std::literals;
@@ -38,7 +41,7 @@ class SMCE_SDImpl : public SDClass {
   public:
     constexpr SMCE_SDImpl() noexcept : SDClass{} {}
     std::filesystem::path root() {
-        maybe_init();
+        ++io_activity;
         return board_view.storage_get_root(BoardView::Link::SPI, m_cspin);
     }
 };
@@ -58,32 +61,33 @@ File::operator bool() noexcept { return static_cast<bool>(m_u); }
 
 const char* File::name() {
     if (!m_u)
-        return std::cerr << "File::name(): File not opened" << std::endl, nullptr;
+        return diagnose("File::name", "File not opened"), nullptr;
     return m_u->filename.c_str();
 }
 
 unsigned long File::position() {
     if (!m_u)
-        return std::cerr << "File::position(): File not opened" << std::endl, 0;
+        return diagnose("File::position", "File not opened"), 0;
 
     auto* const strm_ptr = std::get_if<std::fstream>(&m_u->payload);
     if (!strm_ptr)
-        return std::cerr << "File::position(): File is a directory" << std::endl, 0;
+        return diagnose("File::position", "File is a directory"), 0;
 
     return strm_ptr->tellg();
 }
 
 bool File::seek(unsigned long pos) {
     if (!m_u)
-        return std::cerr << "File::seek(" << pos << "): File not opened" << std::endl, false;
+        return diagnose("File::seek(pos)", "File not opened"), false;
 
     auto* const strm_ptr = std::get_if<std::fstream>(&m_u->payload);
     if (!strm_ptr)
-        return std::cerr << "File::seek(" << pos << "): File is a directory" << std::endl, false;
+        return diagnose("File::seek(pos)", "File is a directory"), false;
 
     if (const auto max_pos = size(); pos > max_pos) {
-        std::cerr << "File::seek(" << pos << "): Target cursor position is out of bounds (size() == " << max_pos << ")"
-                  << std::endl;
+        if (diagnostic_due("File::seek(pos)", "Target cursor position is out of bounds"))
+            std::cerr << "File::seek(" << pos << "): Target cursor position is out of bounds (size() == " << max_pos
+                      << ")\n";
         return false;
     }
 
@@ -94,11 +98,11 @@ bool File::seek(unsigned long pos) {
 
 unsigned long File::size() {
     if (!m_u)
-        return std::cerr << "File::size(): File not opened" << std::endl, 0;
+        return diagnose("File::size", "File not opened"), 0;
 
     auto* const strm_ptr = std::get_if<std::fstream>(&m_u->payload);
     if (!strm_ptr)
-        return std::cerr << "File::size(): File is a directory" << std::endl, 0;
+        return diagnose("File::size", "File is a directory"), 0;
 
     const auto save_gpos = strm_ptr->tellg();
     strm_ptr->seekg(0, std::ios::end);
@@ -109,19 +113,19 @@ unsigned long File::size() {
 
 bool File::isDirectory() {
     if (!m_u)
-        return std::cerr << "File::isDirectory(): File not opened" << std::endl, false;
+        return diagnose("File::isDirectory", "File not opened"), false;
     return std::get_if<std::filesystem::directory_iterator>(&m_u->payload);
 }
 
 File File::openNextFile(SMCE_FileOpenMode mode) {
     if (!m_u) {
-        std::cerr << "File::openNextFile(): Current file not opened" << std::endl;
+        diagnose("File::openNextFile", "Current file not opened");
         return {};
     }
 
     auto* const dir_iter_ptr = std::get_if<std::filesystem::directory_iterator>(&m_u->payload);
     if (!dir_iter_ptr) {
-        std::cerr << "File::rewindDirectory(): File is not a directory" << std::endl;
+        diagnose("File::openNextFile", "File is not a directory");
         return {};
     }
 
@@ -159,58 +163,59 @@ File File::openNextFile(SMCE_FileOpenMode mode) {
 
 void File::rewindDirectory() {
     if (!m_u)
-        return (void)(std::cerr << "File::rewindDirectory(): File not opened" << std::endl);
+        return (void)(diagnose("File::rewindDirectory", "File not opened"));
 
     auto* const dir_iter_ptr = std::get_if<std::filesystem::directory_iterator>(&m_u->payload);
     if (!dir_iter_ptr)
-        return (void)(std::cerr << "File::rewindDirectory(): File is not a directory" << std::endl);
+        return (void)(diagnose("File::rewindDirectory", "File is not a directory"));
 
     *dir_iter_ptr = std::filesystem::directory_iterator{m_u->path};
 }
 
 void File::close() {
     if (!m_u)
-        std::cerr << "File::close(): File not opened" << std::endl;
+        diagnose("File::close", "File not opened");
     m_u.reset();
 }
 
 int File::available() {
     if (!m_u)
-        return std::cerr << "File::available(): File not opened" << std::endl, 0;
+        return diagnose("File::available", "File not opened"), 0;
 
     if (!std::get_if<std::fstream>(&m_u->payload))
-        return std::cerr << "File::available(): File is a directory" << std::endl, 0;
+        return diagnose("File::available", "File is a directory"), 0;
 
     return size() - position();
 }
 
 void File::flush() {
     if (!m_u)
-        return (void)(std::cerr << "File::flush(): File not opened" << std::endl);
+        return (void)(diagnose("File::flush", "File not opened"));
     auto* const strm_ptr = std::get_if<std::fstream>(&m_u->payload);
     if (!strm_ptr)
-        return (void)(std::cerr << "File::flush(): File is a directory" << std::endl);
+        return (void)(diagnose("File::flush", "File is a directory"));
     strm_ptr->flush();
 }
 
 int File::peek() {
     if (!m_u)
-        return std::cerr << "File::peek(): File not opened" << std::endl, 0;
+        return diagnose("File::peek", "File not opened"), 0;
 
     auto* const strm_ptr = std::get_if<std::fstream>(&m_u->payload);
     if (!strm_ptr)
-        return std::cerr << "File::peek(): File is a directory" << std::endl, 0;
+        return diagnose("File::peek", "File is a directory"), 0;
 
     return strm_ptr->peek();
 }
 
 int File::read() {
+    SMCE__API_SCOPE(file_read);
     if (!m_u)
-        return std::cerr << "File::read(): File not opened" << std::endl, 0;
+        return diagnose("File::read", "File not opened"), 0;
 
     auto* const strm_ptr = std::get_if<std::fstream>(&m_u->payload);
     if (!strm_ptr)
-        return std::cerr << "File::read(): File is a directory" << std::endl, 0;
+        return diagnose("File::read", "File is a directory"), 0;
 
     const auto ret = strm_ptr->get();
     if (ret == std::fstream::traits_type::eof())
@@ -221,12 +226,13 @@ int File::read() {
 std::size_t File::read(std::uint8_t* buffer, std::size_t size) { return read(reinterpret_cast<char*>(buffer), size); }
 
 std::size_t File::read(char* buffer, std::size_t size) {
+    SMCE__API_SCOPE(file_read);
     if (!m_u)
-        return std::cerr << "File::read(?, " << size << "): File not opened" << std::endl, 0;
+        return diagnose("File::read(buffer, size)", "File not opened"), 0;
 
     auto* const strm_ptr = std::get_if<std::fstream>(&m_u->payload);
     if (!strm_ptr)
-        return std::cerr << "File::read(?, " << size << "): File is a directory" << std::endl, 0;
+        return diagnose("File::read(buffer, size)", "File is a directory"), 0;
 
     strm_ptr->read(buffer, size);
     const auto ret = strm_ptr->gcount();
@@ -235,12 +241,13 @@ std::size_t File::read(char* buffer, std::size_t size) {
 }
 
 std::size_t File::write(std::uint8_t c) {
+    SMCE__API_SCOPE(file_write);
     if (!m_u)
-        return std::cerr << "File::write(" << +c << "): File not opened" << std::endl, 0;
+        return diagnose("File::write(c)", "File not opened"), 0;
 
     auto* const strm_ptr = std::get_if<std::fstream>(&m_u->payload);
     if (!strm_ptr)
-        return std::cerr << "File::write(" << +c << "): File is a directory" << std::endl, 0;
+        return diagnose("File::write(c)", "File is a directory"), 0;
 
     strm_ptr->put(c);
     if (!strm_ptr->bad()) {
@@ -253,12 +260,13 @@ std::size_t File::write(std::uint8_t c) {
 std::size_t File::write(char c) { return write(static_cast<std::uint8_t>(c)); }
 
 std::size_t File::write(const std::uint8_t* buffer, std::size_t size) {
+    SMCE__API_SCOPE(file_write);
     if (!m_u)
-        return std::cerr << "File::write(?, " << size << "): File not opened" << std::endl, 0;
+        return diagnose("File::write(buffer, size)", "File not opened"), 0;
 
     auto* const strm_ptr = std::get_if<std::fstream>(&m_u->payload);
     if (!strm_ptr)
-        return std::cerr << "File::write(?, " << size << "): File is a directory" << std::endl, 0;
+        return diagnose("File::write(buffer, size)", "File is a directory"), 0;
 
     strm_ptr->write(reinterpret_cast<const char*>(buffer), size);
     if (strm_ptr->bad())
@@ -268,11 +276,16 @@ std::size_t File::write(const std::uint8_t* buffer, std::size_t size) {
 }
 
 bool SDClass::begin(std::uint16_t cspin) {
+    const auto error = [=](const char* msg) {
+        if (diagnostic_due("SDClass::begin", msg))
+            std::cerr << "SDClass::begin(" << cspin << "): " << msg << '\n';
+        return false;
+    };
     if (m_begun)
-        return std::cerr << "SDClass::begin(" << cspin << "): already begun" << std::endl, false;
+        return error("already begun");
 
     if (SMCE_SDimpl.root().empty())
-        return std::cerr << "SDClass::begin(" << cspin << "): no such device" << std::endl, false;
+        return error("no such device");
 
     m_cspin = cspin;
     return m_begun = true;
@@ -16,43 +16,300 @@
  *
  */
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string_view>
 #include <thread>
+#include <vector>
+#include <boost/predef.h>
+#if BOOST_OS_LINUX
+#    include <sys/prctl.h>
+#endif
 #include "SMCE/BoardView.hpp"
+#include "SMCE/internal/ApiCounters.hpp"
+#include "SMCE/internal/BoardData.hpp"
+#include "SMCE/internal/BoardEvents.hpp"
 #include "SMCE/internal/SharedBoardData.hpp"
 #include "SMCE.hpp"
 
 using namespace std::chrono_literals;
 
+// The runtime state below must be live before any static initializer of the sketch gets to touch the board,
+// which matters most when Ardrivo is linked statically into the sketch executable
+#if defined(_MSC_VER)
+#    pragma init_seg(lib)
+#    define SMCE__RT_INIT_EARLY
+#elif defined(__GNUC__) && !defined(__APPLE__)
+#    define SMCE__RT_INIT_EARLY __attribute__((init_priority(101)))
+#else
+#    define SMCE__RT_INIT_EARLY
+#endif
+
 namespace smce {
 
-smce::SharedBoardData sbd;
-smce::BoardView board_view;
+/// Upper bound on the size of the direct-indexed lookup tables; larger ids go through the BoardView lookup
+constexpr std::size_t max_direct_table_size = 1024;
+
+SMCE__RT_INIT_EARLY smce::SharedBoardData sbd;
+SMCE__RT_INIT_EARLY smce::BoardView board_view;
+/// Pin views resolved once at startup, indexed by pin id
+SMCE__RT_INIT_EARLY std::vector<VirtualPin> pin_views;
+/// Framebuffer views resolved once at startup, indexed by key
+SMCE__RT_INIT_EARLY std::vector<FrameBuffer> frame_buffer_views;
+/// Final stretch of delays to busy-wait through
+std::chrono::nanoseconds delay_spin_threshold{};
+/// Bumped by every access to the board; lets the loop pacer tell whether an iteration performed any I/O
+std::uint64_t io_activity = 0;
+/// Bytes Serial coalesces its writes into before publishing them; 0 to publish every write right away
+std::size_t serial_flushing_threshold = 0;
+/// Whether Serial publishes its coalesced writes at the end of every line
+bool serial_flush_on_newline = false;
+
+void precise_sleep_until(std::chrono::steady_clock::time_point deadline) noexcept;
+void flush_serial(bool only_if_due) noexcept;
 
-void maybe_init() {
-    if (sbd.get_board_data())
-        return;
+static bool open_board() noexcept try {
     const char* segname = std::getenv("SEGNAME");
     if (!segname)
         segname = ".";
-    sbd.open_as_child(segname);
-    board_view = smce::BoardView{*sbd.get_board_data()};
+    if (!sbd.open_as_child(segname) || !sbd.get_board_data())
+        return false;
+    auto& bdat = *sbd.get_board_data();
+    board_view = smce::BoardView{bdat};
+    is_sketch_process = true;
+    delay_spin_threshold = std::chrono::nanoseconds{bdat.delay_spin_threshold_ns};
+#if BOOST_OS_LINUX
+    // Keep the kernel from coalescing our wake-ups when the board asks for timing accuracy
+    if (delay_spin_threshold.count() > 0)
+        prctl(PR_SET_TIMERSLACK, 1UL);
+#endif
+    if (!bdat.uart_channels.empty()) {
+        const auto& serial = bdat.uart_channels.front();
+        serial_flushing_threshold = serial.flushing_threshold;
+        serial_flush_on_newline = serial.flush_on_newline;
+    }
+
+    // Pins and framebuffers are stored sorted by id, so the last one holds the largest
+    if (!bdat.pins.empty()) {
+        const auto table_size = std::min<std::size_t>(bdat.pins.back().id + 1, max_direct_table_size);
+        pin_views.reserve(table_size);
+        for (std::size_t id = 0; id < table_size; ++id)
+            pin_views.push_back(board_view.pins[id]);
+    }
+    if (!bdat.frame_buffers.empty()) {
+        const auto table_size = std::min<std::size_t>(bdat.frame_buffers.back().key + 1, max_direct_table_size);
+        frame_buffer_views.reserve(table_size);
+        for (std::size_t key = 0; key < table_size; ++key)
+            frame_buffer_views.push_back(board_view.frame_buffers[key]);
+    }
+    return true;
+} catch (const std::exception& e) {
+    std::fputs("Failed to open board segment: ", stderr);
+    std::fputs(e.what(), stderr);
+    std::fputs("\n", stderr);
+    return false;
+}
+
+/// Opens the board segment exactly once, ahead of any sketch code
+SMCE__RT_INIT_EARLY const struct BoardOpener {
+    bool opened = open_board();
+} board_opener;
+
+#if SMCE__API_COUNTERS
+namespace {
+/// Calls accounted for by a thread which have yet to be flushed into the board
+struct LocalApiCounters {
+    struct Counter {
+        std::uint64_t calls;
+        std::uint64_t failures;
+        std::int64_t total_ns;
+    };
+    std::array<Counter, ardrivo_api_names.size()> counters{};
+    std::uint32_t pending = 0;
+    ApiScope* innermost = nullptr;
+
+    LocalApiCounters() noexcept = default;
+    LocalApiCounters(const LocalApiCounters&) = delete;
+    LocalApiCounters& operator=(const LocalApiCounters&) = delete;
+    ~LocalApiCounters() { flush(); }
+
+    void flush() noexcept {
+        if (!pending || !sbd.get_board_data())
+            return;
+        auto& shared = sbd.get_board_data()->api_counters;
+        for (std::size_t i = 0; i < counters.size(); ++i) {
+            auto& counter = counters[i];
+            if (!counter.calls)
+                continue;
+            shared[i].calls.fetch_add(counter.calls);
+            shared[i].failures.fetch_add(counter.failures);
+            shared[i].total_ns.fetch_add(counter.total_ns);
+            counter = {};
+        }
+        pending = 0;
+    }
+};
+/// Calls a thread accounts for before flushing them on its own
+constexpr std::uint32_t api_flush_threshold = 256;
+thread_local LocalApiCounters local_api_counters;
+} // namespace
+
+ApiScope::ApiScope(ArdrivoApi api) noexcept
+    : m_api{api}, m_parent{local_api_counters.innermost}, m_start{std::chrono::steady_clock::now()} {
+    local_api_counters.innermost = this;
+}
+
+ApiScope::~ApiScope() {
+    const auto duration = std::chrono::steady_clock::now() - m_start;
+    auto& local = local_api_counters;
+    local.innermost = m_parent;
+    auto& counter = local.counters[static_cast<std::size_t>(m_api)];
+    ++counter.calls;
+    counter.failures += m_failed;
+    counter.total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    if (++local.pending >= api_flush_threshold)
+        local.flush();
 }
 
+void ApiScope::fail() noexcept {
+    if (auto* const scope = local_api_counters.innermost)
+        scope->m_failed = true;
+}
+
+void flush_api_counters() noexcept { local_api_counters.flush(); }
+#endif
+
+/// Minimum time between two log lines for the same diagnostic
+constexpr auto diagnostics_log_interval = 1s;
+
+std::uint64_t diagnostic_due(std::string_view site, std::string_view message) noexcept {
+#if SMCE__API_COUNTERS
+    ApiScope::fail();
+#endif
+    if (!board_view.valid())
+        return 1;
+    return board_view.diagnostics.report(site, message, diagnostics_log_interval);
+}
+
+void diagnose(std::string_view site, std::string_view message) noexcept {
+    if (diagnostic_due(site, message))
+        std::cerr << site << ": " << message << '\n';
+}
+
+/// Accounts for one loop() iteration; the board is the only writer, so plain loads and stores suffice
+static void record_iteration(BoardData::LoopStats& stats, std::chrono::nanoseconds duration) noexcept {
+    constexpr auto relaxed = boost::memory_order_relaxed;
+    const auto ns = duration.count();
+    const auto bucket = std::min<std::size_t>(std::bit_width(static_cast<std::uint64_t>(ns)), stats.buckets.size() - 1);
+    stats.buckets[bucket].store(stats.buckets[bucket].load(relaxed) + 1, relaxed);
+    stats.total_ns.store(stats.total_ns.load(relaxed) + ns, relaxed);
+    if (ns > stats.max_ns.load(relaxed))
+        stats.max_ns.store(ns, relaxed);
+    stats.iterations.store(stats.iterations.load(relaxed) + 1, boost::memory_order_release);
+}
+
+/**
+ * Paces the iterations of loop() according to the board's policy and measures the rate achieved
+ **/
+class SMCE_INTERNAL LoopPacer {
+    using Clock = std::chrono::steady_clock;
+    using Policy = BoardData::LoopPacing::Policy;
+    constexpr static auto rate_window = 250ms;
+    constexpr static std::chrono::nanoseconds min_backoff = 50us;
+
+    BoardData& m_bdat;
+    const Policy m_policy;
+    const std::chrono::nanoseconds m_period;
+    const std::chrono::nanoseconds m_max_backoff;
+    Clock::time_point m_next_start = Clock::now();
+    std::chrono::nanoseconds m_backoff{};
+    std::uint64_t m_last_io = io_activity;
+    Clock::time_point m_window_start = Clock::now();
+    std::uint64_t m_window_iterations = 0;
+
+  public:
+    explicit LoopPacer(BoardData& bdat) noexcept
+        : m_bdat{bdat}, m_policy{bdat.loop_pacing.policy == Policy::fixed_rate && !bdat.loop_pacing.period_ns
+                                     ? Policy::free_run
+                                     : bdat.loop_pacing.policy},
+          m_period{bdat.loop_pacing.period_ns}, m_max_backoff{bdat.loop_pacing.max_backoff_ns} {}
+
+    /// Waits until the next iteration is due to start
+    void pace(Clock::time_point iteration_start, Clock::time_point now) noexcept {
+        switch (m_policy) {
+        case Policy::free_run:
+            if (now - iteration_start < 1ms)
+                std::this_thread::yield();
+            break;
+        case Policy::fixed_rate:
+            m_next_start += m_period;
+            // Drop the iterations we are late on instead of bursting through them
+            if (m_next_start < now)
+                m_next_start = now;
+            else
+                precise_sleep_until(m_next_start);
+            break;
+        case Policy::adaptive:
+            if (m_last_io != io_activity) {
+                m_last_io = io_activity;
+                m_backoff = {};
+                break;
+            }
+            m_backoff = std::clamp(m_backoff * 2, min_backoff, std::max(m_max_backoff, min_backoff));
+            std::this_thread::sleep_for(m_backoff);
+            break;
+        }
+
+        ++m_window_iterations;
+        const auto window_end = Clock::now();
+        if (const auto elapsed = window_end - m_window_start; elapsed >= rate_window) {
+            m_bdat.loop_rate.store(static_cast<double>(m_window_iterations) /
+                                   std::chrono::duration<double>{elapsed}.count());
+            m_window_start = window_end;
+            m_window_iterations = 0;
+        }
+    }
+};
+
 } // namespace smce
 
 int SMCE__main([[maybe_unused]] int argc, [[maybe_unused]] char** argv, SetupSig* setup, LoopSig* loop) noexcept try {
-    smce::maybe_init();
+    if (!smce::board_opener.opened) {
+        std::fputs("Board segment unavailable; terminating\n", stderr);
+        return EXIT_FAILURE;
+    }
+    auto& bdat = *smce::sbd.get_board_data();
+    using TracePhase = smce::Tracing::Phase;
+    constexpr auto trace_source = smce::Tracing::Source::board;
+    auto& tracing = smce::board_view.tracing;
+    const auto setup_start = std::chrono::steady_clock::now();
+    tracing.record(trace_source, TracePhase::begin, "setup");
     setup();
+    tracing.record(trace_source, TracePhase::end, "setup");
+    const auto setup_duration = std::chrono::steady_clock::now() - setup_start;
+    bdat.loop_stats.setup_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(setup_duration).count());
+    smce::LoopPacer pacer{bdat};
     while (!smce::board_view.stop_requested()) {
         const auto loop_start = std::chrono::steady_clock::now();
+        tracing.record(trace_source, TracePhase::begin, "loop");
         loop();
+        tracing.record(trace_source, TracePhase::end, "loop");
         const auto loop_end = std::chrono::steady_clock::now();
-        if (loop_end - loop_start < 1ms)
-            std::this_thread::yield();
+        const auto loop_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(loop_end - loop_start);
+        smce::record_iteration(bdat.loop_stats, loop_duration);
+        pacer.pace(loop_start, loop_end);
+        smce::flush_serial(true);
+#if SMCE__API_COUNTERS
+        smce::flush_api_counters();
+#endif
     }
+    smce::flush_serial(false);
     return EXIT_SUCCESS;
 } catch (const std::exception& e) {
     std::fputs("Exception occurred:", stderr);
@@ -22,16 +22,18 @@
 
 namespace smce {
 extern BoardView board_view;
-extern void maybe_init();
+extern std::uint64_t io_activity;
 } // namespace smce
 
 namespace smce_rt {
 
 static smce::VirtualDeviceField field(const char* dnam, std::size_t didx, const char* fnam) {
+    ++smce::io_activity;
     return smce::BoardDeviceView{smce::board_view}[dnam][didx][fnam];
 }
 
-SMCE__DLL_API void devices_init() { smce::maybe_init(); }
+// The board is opened ahead of any sketch code by the runtime; kept for the generated bindings
+SMCE__DLL_API void devices_init() {}
 
 SMCE__DLL_API std::size_t device_count(const char* dnam) {
     return smce::BoardDeviceView{smce::board_view}[dnam].size();
@@ -21,6 +21,15 @@
 
 #if BOOST_OS_UNIX || BOOST_OS_MACOS
 #    include <csignal>
+#    include <fcntl.h>
+#    include <sys/resource.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+#    if BOOST_OS_LINUX
+#        include <sched.h>
+#        include <sys/eventfd.h>
+#        include <sys/syscall.h>
+#    endif
 #elif BOOST_OS_WINDOWS
 #    define WIN32_LEAN_AND_MEAN
 #    include <Windows.h>
@@ -35,22 +44,65 @@ __declspec(dllimport) LONG NTAPI NtSuspendProcess(HANDLE ProcessHandle);
 #    error "Unsupported platform"
 #endif
 
+#include <algorithm>
+#include <array>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 #include <SMCE/BoardConf.hpp>
 #include <SMCE/BoardView.hpp>
 #include <SMCE/Toolchain.hpp>
 #include <SMCE/Uuid.hpp>
 #include <SMCE/internal/BoardData.hpp>
+#include <SMCE/internal/BoardEvents.hpp>
 #include <SMCE/internal/SharedBoardData.hpp>
+#include <SMCE/internal/UartLink.hpp>
 #include <SMCE/internal/portable/scope.hpp>
 #include <SMCE/internal/utils.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <boost/process.hpp>
+#include <boost/process/extend.hpp>
 
 namespace bp = boost::process;
+namespace bip = boost::interprocess;
 
 namespace smce {
+namespace detail {
+
+struct board_image_error_category : public std::error_category {
+  public:
+    const char* name() const noexcept override { return "smce.board_image"; }
+
+    std::string message(int ev) const override {
+        switch (static_cast<board_image_error>(ev)) {
+        case board_image_error::invalid_state:
+            return "Board is not in a state allowing the operation";
+        case board_image_error::malformed:
+            return "Board image is malformed or truncated";
+        case board_image_error::incompatible:
+            return "Board image was captured under a different configuration or build";
+        default:
+            return "smce.board_image error";
+        }
+    }
+};
+
+const std::error_category& get_board_image_error_category() noexcept {
+    static const board_image_error_category cat{};
+    return cat;
+}
+
+} // namespace detail
+
+std::error_code make_error_code(board_image_error ev) noexcept {
+    return std::error_code{static_cast<std::underlying_type_t<board_image_error>>(ev),
+                           detail::get_board_image_error_category()};
+}
 
 struct SMCE_INTERNAL Board::Internal {
     Uuid uuid = Uuid::generate();
@@ -58,8 +110,99 @@ struct SMCE_INTERNAL Board::Internal {
     bp::child sketch;
     bp::ipstream sketch_log;
     std::thread sketch_log_grabber;
+    std::optional<ResourceUsage> last_usage;
+    /// Link segment one of whose ends is a channel of this board
+    struct UartLinkEnd {
+        std::string name;
+        Internal* peer;                    // board at the other end; may be this one
+        BoardData::UartChannel* peer_chan; // channel at the other end
+    };
+    std::vector<UartLinkEnd> uart_links;
+    int event_fd = -1; // eventfd the sketch raises events through; Linux only
+
+    Internal() {
+#if BOOST_OS_UNIX || BOOST_OS_MACOS
+        // Sketches of other boards would otherwise inherit the pipe, and hold its grabber up past our sketch's exit
+        ::fcntl(sketch_log.pipe().native_source(), F_SETFD, FD_CLOEXEC);
+        ::fcntl(sketch_log.pipe().native_sink(), F_SETFD, FD_CLOEXEC);
+#endif
+    }
+
+    /// Tears down the links of this board, disconnecting the channels at their other ends as well
+    void release_uart_links() noexcept {
+        const auto links = std::exchange(uart_links, {});
+        for (const auto& link : links) {
+            set_uart_link(*link.peer_chan, {}, 0);
+            std::erase_if(link.peer->uart_links, [&](const UartLinkEnd& end) { return end.name == link.name; });
+            release_uart_link(link.name);
+        }
+    }
+    ~Internal() {
+        release_uart_links();
+#if BOOST_OS_LINUX
+        if (event_fd != -1)
+            ::close(event_fd);
+#endif
+    }
 };
 
+#if BOOST_OS_LINUX
+/**
+ * Fills the process figures of a usage sample from procfs
+ * \param pid - process to inspect
+ * \param usage - sample to fill; left untouched on fields which could not be read
+ **/
+static void sample_process_usage(int pid, Board::ResourceUsage& usage) {
+    const auto proc_dir = "/proc/" + std::to_string(pid);
+
+    // The command name may contain spaces and parentheses; fields are only reliable past the last ')'
+    if (std::ifstream stat_file{proc_dir + "/stat"}) {
+        const std::string stat{std::istreambuf_iterator<char>{stat_file}, {}};
+        if (const auto name_end = stat.rfind(')'); name_end != std::string::npos) {
+            std::istringstream fields{stat.substr(name_end + 1)};
+            std::string state;
+            long long ignored{};
+            unsigned long long minflt{}, majflt{}, utime{}, stime{};
+            // fields 3 to 15 of proc(5)
+            fields >> state >> ignored >> ignored >> ignored >> ignored >> ignored >> ignored >> minflt >> ignored >>
+                majflt >> ignored >> utime >> stime;
+            if (fields) {
+                const auto tick = std::chrono::nanoseconds{std::chrono::seconds{1}} / ::sysconf(_SC_CLK_TCK);
+                usage.minor_faults = minflt;
+                usage.major_faults = majflt;
+                usage.user_time = tick * utime;
+                usage.system_time = tick * stime;
+            }
+        }
+    }
+
+    std::ifstream status_file{proc_dir + "/status"};
+    for (std::string line; std::getline(status_file, line);) {
+        const auto colon = line.find(':');
+        if (colon == std::string::npos)
+            continue;
+        const std::string_view key{line.data(), colon};
+        std::istringstream value{line.substr(colon + 1)};
+        std::uint64_t figure{};
+        if (!(value >> figure))
+            continue;
+        if (key == "VmRSS")
+            usage.resident_memory = figure * 1024; // reported in kB
+        else if (key == "voluntary_ctxt_switches")
+            usage.voluntary_context_switches = figure;
+        else if (key == "nonvoluntary_ctxt_switches")
+            usage.involuntary_context_switches = figure;
+    }
+}
+
+/// Makes an eventfd non-readable until it gets written again
+static void drain_event_fd(int fd) noexcept {
+    std::uint64_t count;
+    if (fd != -1)
+        [[maybe_unused]] const auto drained = ::read(fd, &count, sizeof(count));
+}
+#endif
+
 Board::Board(std::function<void(int)> exit_notify) noexcept
     : m_exit_notify{std::move(exit_notify)}, m_internal{std::make_unique<Internal>()} {
     m_runtime_log.reserve(4096);
@@ -126,7 +269,16 @@ bool Board::prepare() noexcept {
     if (m_status != Status::configured && m_status != Status::stopped)
         return false;
 
-    m_internal->sbdata.configure("SMCE-Runner-" + m_internal->uuid.to_hex(), *m_conf_opt);
+    auto& in = *m_internal;
+    in.release_uart_links();
+    in.sbdata.configure("SMCE-Runner-" + in.uuid.to_hex(), *m_conf_opt);
+#if BOOST_OS_LINUX
+    // Created close-on-exec, so that only the sketch of this board inherits it
+    if (in.event_fd == -1)
+        in.event_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    drain_event_fd(in.event_fd); // events of the previous run went away with its board data
+    in.sbdata.get_board_data()->event_fd = in.event_fd;
+#endif
 
     m_status = Status::prepared;
     return true;
@@ -148,7 +300,8 @@ bool Board::start() noexcept {
             return false;
     }
 
-    do_spawn();
+    if (!do_spawn())
+        return false;
 
     m_status = Status::running;
     return true;
@@ -207,22 +360,454 @@ bool Board::stop(std::chrono::milliseconds timeout) noexcept {
     return exited;
 }
 
+std::error_code Board::snapshot(std::vector<std::byte>& image) noexcept try {
+    if (m_status != Status::prepared && m_status != Status::suspended)
+        return board_image_error::invalid_state;
+    return m_internal->sbdata.save_image(image);
+} catch (...) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+
+std::error_code Board::snapshot(const stdfs::path& file) noexcept try {
+    std::vector<std::byte> image;
+    if (const auto ec = snapshot(image))
+        return ec;
+    std::ofstream out{file, std::ios::binary | std::ios::trunc};
+    out.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+    out.close();
+    if (!out)
+        return std::make_error_code(std::errc::io_error);
+    return {};
+} catch (...) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+
+std::error_code Board::restore(std::span<const std::byte> image) noexcept try {
+    if (m_status != Status::prepared)
+        return board_image_error::invalid_state;
+    return m_internal->sbdata.load_image(image);
+} catch (...) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+
+std::error_code Board::restore(const stdfs::path& file) noexcept try {
+    if (m_status != Status::prepared)
+        return board_image_error::invalid_state;
+    const bip::file_mapping mapping{file.string().c_str(), bip::read_only};
+    const bip::mapped_region region{mapping, bip::read_only};
+    return restore({static_cast<const std::byte*>(region.get_address()), region.get_size()});
+} catch (const bip::interprocess_exception& e) {
+    return {static_cast<int>(e.get_native_error()), std::system_category()};
+} catch (...) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+
+std::error_code Board::link_uart(std::size_t channel, Board& peer, std::size_t peer_channel) noexcept try {
+    if (m_status != Status::prepared || peer.m_status != Status::prepared)
+        return std::make_error_code(std::errc::operation_not_permitted);
+    auto& chans = m_internal->sbdata.get_board_data()->uart_channels;
+    auto& peer_chans = peer.m_internal->sbdata.get_board_data()->uart_channels;
+    if (channel >= chans.size() || peer_channel >= peer_chans.size())
+        return std::make_error_code(std::errc::invalid_argument);
+    auto& chan = chans[channel];
+    auto& peer_chan = peer_chans[peer_channel];
+    if (&chan == &peer_chan || !chan.link.empty() || !peer_chan.link.empty())
+        return std::make_error_code(std::errc::invalid_argument);
+    // Both ends share the wire, so they need to agree on its pace if both keep to one
+    if (chan.byte_time && peer_chan.byte_time && chan.byte_time != peer_chan.byte_time)
+        return std::make_error_code(std::errc::invalid_argument);
+
+    const auto name = "SMCE-Link-" + Uuid::generate().to_hex();
+    // Both ends get recorded, in the same list when linking two channels of this board
+    const std::size_t ends = &peer == this ? 2 : 1;
+    m_internal->uart_links.reserve(m_internal->uart_links.size() + ends);
+    peer.m_internal->uart_links.reserve(peer.m_internal->uart_links.size() + ends);
+    const std::array<std::size_t, 2> capacities{std::min(chan.max_buffered_tx, peer_chan.max_buffered_rx),
+                                                std::min(peer_chan.max_buffered_tx, chan.max_buffered_rx)};
+    if (!create_uart_link(name, capacities, std::max(chan.byte_time, peer_chan.byte_time)))
+        return std::make_error_code(std::errc::io_error);
+    m_internal->uart_links.push_back({name, peer.m_internal.get(), &peer_chan});
+    peer.m_internal->uart_links.push_back({name, m_internal.get(), &chan});
+    set_uart_link(chan, name, 0);
+    set_uart_link(peer_chan, name, 1);
+    return {};
+} catch (const std::bad_alloc&) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+
+[[nodiscard]] int Board::event_fd() const noexcept { return m_internal ? m_internal->event_fd : -1; }
+
+[[nodiscard]] Board::Events Board::take_events() noexcept {
+    auto& in = *m_internal;
+    auto* const bdat = in.sbdata.get_board_data();
+    if (!bdat)
+        return {};
+#if BOOST_OS_LINUX
+    // Rearm before taking, so that events raised from now on wake the host up again
+    drain_event_fd(in.event_fd);
+#endif
+    const auto bits = bdat->pending_events.exchange(0);
+    return {.uart_tx = (bits & uart_tx_event) != 0,
+            .pins = (bits & pins_event) != 0,
+            .frame_buffers = (bits & frame_buffers_event) != 0,
+            .devices = (bits & devices_event) != 0,
+            .exited = (bits & exited_event) != 0};
+}
+
 /**
- * Spawns the child process and its log grabber
+ * Scheduling of a sketch, resolved ahead of the fork so that the child only has to issue system calls
  **/
-void Board::do_spawn() noexcept {
+class SpawnScheduling {
+    const BoardConfig::Scheduling& m_conf;
+    [[maybe_unused]] int m_cgroup_procs = -1;
+
+  public:
+    explicit SpawnScheduling(const BoardConfig::Scheduling& conf) noexcept : m_conf{conf} {}
+    SpawnScheduling(const SpawnScheduling&) = delete;
+    SpawnScheduling& operator=(const SpawnScheduling&) = delete;
+    ~SpawnScheduling();
+
+    /// Validates the configuration and sets up its cgroup; run in the parent
+    std::error_code prepare() noexcept;
+    /// Applies the configuration to the calling process; async-signal-safe
+    std::error_code apply() const noexcept;
+};
 
+SpawnScheduling::~SpawnScheduling() {
+#if BOOST_OS_LINUX
+    if (m_cgroup_procs != -1)
+        ::close(m_cgroup_procs);
+#endif
+}
+
+#if BOOST_OS_LINUX
+static std::error_code write_file(const stdfs::path& path, std::string_view content) noexcept {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd == -1)
+        return {errno, std::system_category()};
+    const bool written = ::write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size());
+    const int err = errno;
+    ::close(fd);
+    return written ? std::error_code{} : std::error_code{err, std::system_category()};
+}
+#endif
+
+std::error_code SpawnScheduling::prepare() noexcept try {
+    using Policy = BoardConfig::Scheduling::Policy;
+    const auto& conf = m_conf;
+    const auto invalid = std::make_error_code(std::errc::invalid_argument);
+
+    if (conf.nice < -20 || conf.nice > 19)
+        return invalid;
+    if (conf.policy == Policy::fifo && (conf.priority < 1 || conf.priority > 99))
+        return invalid;
+    if (conf.policy == Policy::deadline) {
+        const auto period = conf.period.count() ? conf.period : conf.deadline;
+        if (conf.runtime.count() <= 0 || conf.runtime > conf.deadline || conf.deadline > period)
+            return invalid;
+    }
+    if (conf.cpu_quota && conf.cgroup.empty())
+        return invalid;
+
+#if BOOST_OS_LINUX
+    if (std::any_of(conf.cpu_affinity.begin(), conf.cpu_affinity.end(), [](auto cpu) { return cpu >= CPU_SETSIZE; }))
+        return invalid;
+
+    if (!conf.cgroup.empty()) {
+        std::error_code ec;
+        stdfs::create_directories(conf.cgroup, ec);
+        if (ec)
+            return ec;
+        if (conf.cpu_quota) {
+            constexpr std::uint64_t period_us = 100'000;
+            const auto quota_us = std::uint64_t{conf.cpu_quota} * period_us / 100;
+            const auto cpu_max = std::to_string(quota_us) + ' ' + std::to_string(period_us) + '\n';
+            if (const auto write_ec = write_file(conf.cgroup / "cpu.max", cpu_max))
+                return write_ec;
+        }
+        m_cgroup_procs = ::open((conf.cgroup / "cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+        if (m_cgroup_procs == -1)
+            return {errno, std::system_category()};
+    }
+#else
+    if (!conf.cpu_affinity.empty() || conf.policy != Policy::normal || !conf.cgroup.empty())
+        return std::make_error_code(std::errc::not_supported);
+#    if BOOST_OS_WINDOWS
+    if (conf.nice != 0)
+        return std::make_error_code(std::errc::not_supported);
+#    endif
+#endif
+    return {};
+} catch (...) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+
+std::error_code SpawnScheduling::apply() const noexcept {
+#if BOOST_OS_UNIX || BOOST_OS_MACOS
+    const auto last_error = [] { return std::error_code{errno, std::system_category()}; };
+#    if BOOST_OS_LINUX
+    // Joining the cgroup first so that its limits are in effect before the policy is raised
+    if (m_cgroup_procs != -1 && ::write(m_cgroup_procs, "0", 1) == -1)
+        return last_error();
+
+    if (!m_conf.cpu_affinity.empty()) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (const auto cpu : m_conf.cpu_affinity)
+            CPU_SET(cpu, &cpus);
+        if (::sched_setaffinity(0, sizeof(cpus), &cpus) == -1)
+            return last_error();
+    }
+#    endif
+
+    if (m_conf.nice != 0 && ::setpriority(PRIO_PROCESS, 0, m_conf.nice) == -1)
+        return last_error();
+
+#    if BOOST_OS_LINUX
+    using Policy = BoardConfig::Scheduling::Policy;
+    switch (m_conf.policy) {
+    case Policy::normal:
+        break;
+    case Policy::fifo: {
+        sched_param param{};
+        param.sched_priority = m_conf.priority;
+        if (::sched_setscheduler(0, SCHED_FIFO, &param) == -1)
+            return last_error();
+        break;
+    }
+    case Policy::deadline: {
+        // Layout of the kernel's struct sched_attr, which older libcs do not expose
+        struct {
+            std::uint32_t size;
+            std::uint32_t sched_policy;
+            std::uint64_t sched_flags;
+            std::int32_t sched_nice;
+            std::uint32_t sched_priority;
+            std::uint64_t sched_runtime;
+            std::uint64_t sched_deadline;
+            std::uint64_t sched_period;
+        } attr{};
+        constexpr std::uint32_t sched_deadline = 6;
+        const auto to_ns = [](std::chrono::microseconds us) {
+            return static_cast<std::uint64_t>(std::chrono::nanoseconds{us}.count());
+        };
+        attr.size = sizeof(attr);
+        attr.sched_policy = sched_deadline;
+        attr.sched_runtime = to_ns(m_conf.runtime);
+        attr.sched_deadline = to_ns(m_conf.deadline);
+        attr.sched_period = to_ns(m_conf.period.count() ? m_conf.period : m_conf.deadline);
+        if (::syscall(SYS_sched_setattr, 0, &attr, 0) == -1)
+            return last_error();
+        break;
+    }
+    }
+#    endif
+#endif
+    return {};
+}
+
+/**
+ * Spawns a sketch through Boost.Process, which forks on POSIX
+ * \param executable - sketch executable
+ * \param segment_name - name of the board's shared memory segment
+ * \param scheduling - prepared scheduling to apply in the child
+ * \param event_fd - descriptor for the sketch to inherit; -1 for none
+ * \param log - stream to redirect the sketch's stderr to
+ * \param child - handle to assign the spawned sketch to
+ **/
+static std::error_code fork_spawn(const stdfs::path& executable, const std::string& segment_name,
+                                  [[maybe_unused]] const SpawnScheduling& scheduling, [[maybe_unused]] int event_fd,
+                                  bp::ipstream& log, bp::child& child) noexcept try {
+    std::error_code ec;
     // clang-format off
-    m_internal->sketch = bp::child{
-        bp::env["SEGNAME"] = "SMCE-Runner-" + m_internal->uuid.to_hex(),
-        "\"" + m_sketch_ptr->m_executable.string() + "\"",
+    child = bp::child{
+        bp::env["SEGNAME"] = segment_name,
+        "\"" + executable.string() + "\"",
         bp::std_out > bp::null,
-        bp::std_err > m_internal->sketch_log
+        bp::std_err > log,
+        ec
 #if BOOST_OS_WINDOWS
         , bp::windows::create_no_window
+#else
+        , bp::extend::on_exec_setup = [&](auto& exec) {
+            if (const auto apply_ec = scheduling.apply()) {
+                exec.set_error(apply_ec, "Failed to apply the sketch's scheduling");
+                ::_exit(EXIT_FAILURE);
+            }
+#    if BOOST_OS_LINUX
+            if (event_fd != -1 && ::fcntl(event_fd, F_SETFD, 0) == -1) {
+                exec.set_error(std::error_code{errno, std::system_category()}, "Failed to pass the event descriptor");
+                ::_exit(EXIT_FAILURE);
+            }
+#    endif
+        }
+        , bp::extend::on_error = [](auto& exec, const std::error_code&) {
+            // the child may have exited past the fork; nobody else holds its pid to reap it
+            if (exec.pid > 0)
+                ::waitpid(exec.pid, nullptr, 0);
+        }
 #endif
     };
     // clang-format on
+    return ec;
+} catch (...) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+
+#if BOOST_OS_LINUX
+/// Everything a vfork child needs, laid out by the host as the child may neither allocate nor return
+struct VforkContext {
+    const char* executable;
+    char* const* argv;
+    char* const* envp;
+    int log_source;
+    int log_sink;
+    int event_fd;
+    const SpawnScheduling& scheduling;
+    sigset_t host_sigmask;
+    int error = 0; // errno of the failed step, written by the child
+};
+
+static int vfork_child(void* arg) noexcept {
+    auto& ctx = *static_cast<VforkContext*>(arg);
+    const auto fail = [&] {
+        ctx.error = errno;
+        ::_exit(127);
+    };
+
+    // Handlers installed by the host would run on its memory; only restore its mask once they are gone
+    for (int sig = 1; sig < NSIG; ++sig) {
+        struct sigaction action {};
+        if (::sigaction(sig, nullptr, &action) == 0 && action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN) {
+            action = {};
+            action.sa_handler = SIG_DFL;
+            ::sigaction(sig, &action, nullptr);
+        }
+    }
+    ::sigprocmask(SIG_SETMASK, &ctx.host_sigmask, nullptr);
+
+    const int null_fd = ::open("/dev/null", O_WRONLY);
+    if (null_fd == -1 || ::dup2(null_fd, STDOUT_FILENO) == -1 || ::dup2(ctx.log_sink, STDERR_FILENO) == -1)
+        fail();
+    ::close(null_fd);
+    ::close(ctx.log_sink);
+    ::close(ctx.log_source);
+    if (ctx.event_fd != -1 && ::fcntl(ctx.event_fd, F_SETFD, 0) == -1)
+        fail();
+
+    if (const auto ec = ctx.scheduling.apply()) {
+        errno = ec.value();
+        fail();
+    }
+
+    ::execve(ctx.executable, ctx.argv, ctx.envp);
+    fail();
+    return 127;
+}
+
+/**
+ * Spawns a sketch with `clone(CLONE_VM | CLONE_VFORK)`
+ * Unlike fork, no page tables get copied, so starting a board costs the same whatever the host's memory footprint
+ * \note Takes the same parameters as \ref fork_spawn
+ **/
+static std::error_code vfork_spawn(const stdfs::path& executable, const std::string& segment_name,
+                                   const SpawnScheduling& scheduling, int event_fd, bp::ipstream& log,
+                                   bp::child& child) noexcept try {
+    const auto exe = executable.string();
+    const auto segname_var = "SEGNAME=" + segment_name;
+    std::vector<char*> envp;
+    for (char** var = ::environ; *var; ++var) {
+        if (!std::string_view{*var}.starts_with("SEGNAME="))
+            envp.push_back(*var);
+    }
+    envp.push_back(const_cast<char*>(segname_var.c_str()));
+    envp.push_back(nullptr);
+    char* const argv[] = {const_cast<char*>(exe.c_str()), nullptr};
+
+    VforkContext ctx{.executable = exe.c_str(),
+                     .argv = argv,
+                     .envp = envp.data(),
+                     .log_source = log.pipe().native_source(),
+                     .log_sink = log.pipe().native_sink(),
+                     .event_fd = event_fd,
+                     .scheduling = scheduling,
+                     .host_sigmask = {}};
+
+    constexpr std::size_t stack_size = 64 * 1024;
+    const auto stack = std::make_unique<std::byte[]>(stack_size);
+
+    sigset_t all_signals;
+    ::sigfillset(&all_signals);
+    ::pthread_sigmask(SIG_BLOCK, &all_signals, &ctx.host_sigmask);
+    const int pid = ::clone(vfork_child, stack.get() + stack_size, CLONE_VM | CLONE_VFORK | SIGCHLD, &ctx);
+    const int clone_errno = errno;
+    ::pthread_sigmask(SIG_SETMASK, &ctx.host_sigmask, nullptr);
+
+    if (pid == -1)
+        return {clone_errno, std::system_category()};
+    if (ctx.error) {
+        ::waitpid(pid, nullptr, 0);
+        return {ctx.error, std::system_category()};
+    }
+
+    ::close(ctx.log_sink);
+    log.pipe().assign_sink(-1);
+    child = bp::child{bp::child::child_handle{pid}};
+    return {};
+} catch (...) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+#endif
+
+std::optional<Board::ResourceUsage> Board::resource_usage(std::chrono::milliseconds max_age) noexcept try {
+    if (m_status != Status::running && m_status != Status::suspended)
+        return std::nullopt;
+
+    auto& in = *m_internal;
+    const auto now = std::chrono::steady_clock::now();
+    if (in.last_usage && now - in.last_usage->sampled_at < max_age)
+        return in.last_usage;
+
+    ResourceUsage usage{};
+    usage.sampled_at = now;
+#if BOOST_OS_LINUX
+    sample_process_usage(in.sketch.id(), usage);
+#endif
+    usage.shm_size = in.sbdata.segment_size();
+    usage.shm_used = usage.shm_size - in.sbdata.segment_free();
+
+    in.last_usage = usage;
+    return usage;
+} catch (...) {
+    return std::nullopt;
+}
+
+/**
+ * Spawns the child process and its log grabber
+ * \return whether the sketch could be spawned under its configured scheduling
+ **/
+bool Board::do_spawn() noexcept {
+    m_internal->last_usage.reset();
+    const auto segment_name = "SMCE-Runner-" + m_internal->uuid.to_hex();
+
+    SpawnScheduling scheduling{m_conf_opt->scheduling};
+    std::error_code ec = scheduling.prepare();
+    if (!ec) {
+        auto& in = *m_internal;
+#if BOOST_OS_LINUX
+        if (m_conf_opt->spawn_method == BoardConfig::SpawnMethod::vfork)
+            ec = vfork_spawn(m_sketch_ptr->m_executable, segment_name, scheduling, in.event_fd, in.sketch_log,
+                             in.sketch);
+        else
+#endif
+            ec = fork_spawn(m_sketch_ptr->m_executable, segment_name, scheduling, in.event_fd, in.sketch_log,
+                            in.sketch);
+    }
+    if (ec) {
+        [[maybe_unused]] std::lock_guard lk{m_runtime_log_mtx};
+        m_runtime_log += "Failed to spawn the sketch: " + ec.message() + '\n';
+        return false;
+    }
 
     m_internal->sketch_log_grabber = std::thread{[&] {
         const smce::portable::scope_fail<void (*)()> exception_detector{
@@ -244,7 +829,10 @@ void Board::do_spawn() noexcept {
             std::memcpy(m_runtime_log.data() + existing + 1, buf.data(), count);
         }
         stream.pipe().close();
+        // The sketch held the write end of the log pipe until its very end, however it came
+        raise_board_events(*m_internal->sbdata.get_board_data(), exited_event);
     }};
+    return true;
 }
 
 /**
@@ -38,7 +38,8 @@ bool operator==(const BoardConfig::GpioDrivers::AnalogDriver& lhs,
 bool operator==(const BoardConfig::UartChannel& lhs, const BoardConfig::UartChannel& rhs) noexcept {
     return lhs.rx_pin_override == rhs.rx_pin_override && lhs.tx_pin_override == rhs.tx_pin_override &&
            lhs.baud_rate == rhs.baud_rate && lhs.rx_buffer_length == rhs.rx_buffer_length &&
-           lhs.tx_buffer_length == rhs.tx_buffer_length && lhs.flushing_threshold == rhs.flushing_threshold;
+           lhs.tx_buffer_length == rhs.tx_buffer_length && lhs.flushing_threshold == rhs.flushing_threshold &&
+           lhs.flush_on_newline == rhs.flush_on_newline && lhs.paced == rhs.paced && lhs.frame_bits == rhs.frame_bits;
 }
 
 bool operator==(const BoardConfig::SecureDigitalStorage& lhs, const BoardConfig::SecureDigitalStorage& rhs) noexcept {
@@ -19,6 +19,7 @@
 #include "SMCE/internal/BoardData.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <iterator>
 #include <numeric>
 #include <string_view>
@@ -27,9 +28,12 @@
 #include "SMCE/BoardDeviceSpecification.hpp"
 
 namespace bip = boost::interprocess;
+using namespace std::literals;
 
 namespace smce {
 
+BoardData::UartBuffer::UartBuffer(const ShmAllocator<void>& shm_valloc) : storage{shm_valloc} {}
+
 BoardData::UartChannel::UartChannel(const ShmAllocator<void>& shm_valloc) : rx{shm_valloc}, tx{shm_valloc} {}
 
 BoardData::DirectStorage::DirectStorage(const ShmAllocator<void>& shm_valloc) : root_dir{shm_valloc} {}
@@ -44,8 +48,8 @@ static DeviceFieldBanks banks_init(const ShmAllocator<void>& shm_valloc) {
 }
 
 BoardData::BoardData(const ShmAllocator<void>& shm_valloc, const BoardConfig& c) noexcept
-    : pins{shm_valloc}, uart_channels{shm_valloc}, direct_storages{shm_valloc}, frame_buffers{shm_valloc},
-      device_map{shm_valloc}, banks{banks_init(shm_valloc)} {
+    : pins{shm_valloc}, pins_dirty{shm_valloc}, uart_channels{shm_valloc}, direct_storages{shm_valloc},
+      frame_buffers{shm_valloc}, device_map{shm_valloc}, banks{banks_init(shm_valloc)}, trace_rings{shm_valloc} {
     auto sorted_pins = c.pins;
     std::sort(sorted_pins.begin(), sorted_pins.end());
 
@@ -54,6 +58,7 @@ BoardData::BoardData(const ShmAllocator<void>& shm_valloc, const BoardConfig& c)
         auto& pin_obj = pins.emplace_back();
         pin_obj.id = pin_id;
     }
+    pins_dirty.resize((pins.size() + 63) / 64);
 
     for (const auto& gpio_driver : c.gpio_drivers) {
         const auto it = std::find(sorted_pins.begin(), sorted_pins.end(), gpio_driver.pin_id);
@@ -77,10 +82,18 @@ BoardData::BoardData(const ShmAllocator<void>& shm_valloc, const BoardConfig& c)
     for (const auto& conf : c.uart_channels) {
         auto& data = uart_channels.emplace_back(shm_valloc);
         data.baud_rate = conf.baud_rate;
+        if (conf.paced && conf.baud_rate)
+            data.byte_time = conf.frame_bits * std::uint64_t{1'000'000'000} / conf.baud_rate;
         data.rx_pin_override = conf.rx_pin_override;
         data.tx_pin_override = conf.tx_pin_override;
         data.max_buffered_rx = static_cast<std::uint16_t>(conf.rx_buffer_length);
         data.max_buffered_tx = static_cast<std::uint16_t>(conf.tx_buffer_length);
+        // Coalescing past the tx buffer would never publish anything
+        data.flushing_threshold =
+            static_cast<std::uint16_t>(std::min<std::size_t>(conf.flushing_threshold, data.max_buffered_tx));
+        data.flush_on_newline = conf.flush_on_newline;
+        data.rx.storage.resize(data.max_buffered_rx);
+        data.tx.storage.resize(data.max_buffered_tx);
     }
 
     direct_storages.reserve(c.sd_cards.size());
@@ -101,6 +114,17 @@ BoardData::BoardData(const ShmAllocator<void>& shm_valloc, const BoardConfig& c)
         data.direction = BoardData::FrameBuffer::Direction{static_cast<std::uint8_t>(conf.direction)};
     }
 
+    delay_spin_threshold_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(c.delay_spin_threshold).count();
+    loop_pacing.policy = BoardData::LoopPacing::Policy{static_cast<std::uint8_t>(c.loop_pacing.policy)};
+    if (c.loop_pacing.rate)
+        loop_pacing.period_ns = std::chrono::nanoseconds{1s}.count() / c.loop_pacing.rate;
+    loop_pacing.max_backoff_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(c.loop_pacing.max_backoff).count();
+    // The rings take up a good part of the segment, so they only exist on boards which may record events
+    if (c.tracing)
+        trace_rings.resize(2);
+    tracing_enabled = c.tracing;
+
     // Count how many elements are needed per bank
     DeviceFieldBaseGroups needed{0};
     for (const auto& bd : c.board_devices) {
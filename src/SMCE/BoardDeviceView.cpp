@@ -69,8 +69,10 @@ static decltype(auto) field_as(BoardData* bdat, std::size_t base) {
     auto& underlying = bdat->banks[boost::hana::size_c<bank_idx>][base];
     if constexpr (std::is_trivial_v<T>)
         return reinterpret_cast<T&>(underlying);
-    else
+    else if constexpr (std::is_same_v<T, smce_rt::Mutex>)
         return T{&underlying, smce_rt::Impl{}};
+    else // Atomics stamp their bank when stored to
+        return T{&underlying, bdat, smce_rt::Impl{}};
 }
 
 auto VirtualDeviceField::as_u8() -> std::uint8_t& { return field_as<std::uint8_t>(m_bdat, m_base); }
@@ -18,21 +18,168 @@
 
 #include "SMCE/BoardView.hpp"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
 #include <iterator>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <numeric>
+#include <thread>
+#include <vector>
 #include <boost/date_time/microsec_time_clock.hpp>
 #include <boost/date_time/posix_time/posix_time_duration.hpp>
 #include <boost/date_time/posix_time/ptime.hpp>
+#include <boost/predef.h>
+#if BOOST_OS_LINUX
+#    include <unistd.h>
+#endif
 #include "SMCE/internal/BoardData.hpp"
+#include "SMCE/internal/BoardEvents.hpp"
+#include "SMCE/internal/ByteRing.hpp"
+#include "SMCE/internal/InputRecording.hpp"
+#include "SMCE/internal/UartLink.hpp"
 #include "SMCE/internal/utils.hpp"
 
 using microsec_clock = boost::date_time::microsec_clock<boost::posix_time::ptime>;
 
 namespace smce {
 
+std::atomic<InputHook> input_hook{};
+bool is_sketch_process = false;
+
+void raise_board_events(BoardData& bdat, std::uint32_t events) noexcept {
+    if (bdat.pending_events.fetch_or(events) != 0)
+        return;
+#if BOOST_OS_LINUX
+    if (bdat.event_fd != -1) {
+        const std::uint64_t one = 1;
+        [[maybe_unused]] const auto written = ::write(bdat.event_fd, &one, sizeof(one));
+    }
+#endif
+}
+
+static void trace(BoardData& bdat, Tracing::Source source, Tracing::Phase phase, std::string_view name,
+                  std::uint64_t arg = 0) noexcept {
+    if (!bdat.tracing_enabled.load(boost::memory_order_relaxed))
+        return;
+    constexpr auto relaxed = boost::memory_order_relaxed;
+    static thread_local const auto thread =
+        static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    name = name.substr(0, Tracing::max_name_length);
+    std::array<std::uint64_t, 3> packed_name{};
+    static_assert(sizeof(packed_name) == Tracing::max_name_length);
+    std::memcpy(packed_name.data(), name.data(), name.size());
+
+    auto& ring = bdat.trace_rings[static_cast<std::size_t>(source)];
+    const auto idx = ring.head.fetch_add(1, relaxed);
+    auto& event = ring.events[idx % ring.events.size()];
+    event.seq.store(0, relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.ts_ns.store(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count(),
+        relaxed);
+    event.arg.store(arg, relaxed);
+    event.thread.store(thread, relaxed);
+    event.phase.store(static_cast<std::uint8_t>(phase), relaxed);
+    event.name_len.store(static_cast<std::uint8_t>(name.size()), relaxed);
+    for (std::size_t i = 0; i < packed_name.size(); ++i)
+        event.name[i].store(packed_name[i], relaxed);
+    event.seq.store(idx + 1, boost::memory_order_release);
+}
+
 [[nodiscard]] bool BoardView::stop_requested() noexcept { return m_bdat && m_bdat->stop_requested.load(); }
 
+[[nodiscard]] double BoardView::loop_rate() noexcept { return m_bdat ? m_bdat->loop_rate.load() : 0; }
+
+[[nodiscard]] LoopStats BoardView::loop_stats() noexcept {
+    static_assert(LoopStats::bucket_count == BoardData::LoopStats::bucket_count);
+    if (!m_bdat)
+        return {};
+    const auto& stats = m_bdat->loop_stats;
+    LoopStats ret;
+    if (const auto setup_ns = stats.setup_ns.load(); setup_ns >= 0)
+        ret.setup_duration = std::chrono::nanoseconds{setup_ns};
+    ret.iterations = stats.iterations.load();
+    ret.total_duration = std::chrono::nanoseconds{stats.total_ns.load()};
+    ret.max_duration = std::chrono::nanoseconds{stats.max_ns.load()};
+    for (std::size_t i = 0; i < ret.histogram.size(); ++i)
+        ret.histogram[i] = stats.buckets[i].load();
+    return ret;
+}
+
+[[nodiscard]] std::vector<ApiCallStats> BoardView::api_call_stats() {
+    if (!m_bdat)
+        return {};
+    std::vector<ApiCallStats> ret;
+    ret.reserve(ardrivo_api_names.size());
+    for (std::size_t i = 0; i < ardrivo_api_names.size(); ++i) {
+        const auto& counter = m_bdat->api_counters[i];
+        ret.push_back({ardrivo_api_names[i], counter.calls.load(), counter.failures.load(),
+                       std::chrono::nanoseconds{counter.total_ns.load()}});
+    }
+    return ret;
+}
+
+[[nodiscard]] std::chrono::nanoseconds LoopStats::mean_duration() const noexcept {
+    return iterations ? total_duration / static_cast<std::int64_t>(iterations) : std::chrono::nanoseconds{};
+}
+
+[[nodiscard]] std::chrono::nanoseconds LoopStats::percentile(double p) const noexcept {
+    // The histogram is sampled bucket by bucket, so it may not add up to exactly `iterations`
+    const auto sampled = std::accumulate(histogram.begin(), histogram.end(), std::uint64_t{0});
+    if (!sampled)
+        return {};
+    const auto rank = static_cast<std::uint64_t>(std::clamp(p, 0.0, 1.0) * static_cast<double>(sampled));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < histogram.size(); ++i) {
+        seen += histogram[i];
+        if (seen >= rank && histogram[i])
+            return std::min(std::chrono::nanoseconds{(std::int64_t{1} << i) - 1}, max_duration);
+    }
+    return max_duration;
+}
+
+[[nodiscard]] BoardChanges BoardView::changes_since(std::uint64_t generation) {
+    if (!m_bdat)
+        return {};
+    // Parts stamped from now on get a later generation than `current`, and so are reported by the next query
+    const auto current = m_bdat->generation.fetch_add(1);
+    BoardChanges ret;
+    ret.generation = current;
+    const auto changed = [=](const IpcAtomicValue<std::uint64_t>& stamp) { return stamp.load() > generation; };
+
+    if (changed(m_bdat->pins_generation)) {
+        for (const auto& pin : m_bdat->pins) {
+            if (changed(pin.generation))
+                ret.pins.push_back(pin.id);
+        }
+    }
+    for (std::size_t i = 0; i < m_bdat->uart_channels.size(); ++i) {
+        if (changed(m_bdat->uart_channels[i].generation))
+            ret.uart_channels.push_back(i);
+    }
+    for (const auto& fb : m_bdat->frame_buffers) {
+        if (changed(fb.generation))
+            ret.frame_buffers.push_back(fb.key);
+    }
+    if (std::any_of(m_bdat->device_generations.begin(), m_bdat->device_generations.end(), changed)) {
+        for (const auto& [name, device] : m_bdat->device_map) {
+            if (std::any_of(device.fields.begin(), device.fields.end(), [&](const auto& field) {
+                    return changed(m_bdat->device_generations[device_field_type_to_bank_idx[static_cast<std::size_t>(
+                        field.second)]]);
+                }))
+                ret.devices.emplace_back(name.data(), name.size());
+        }
+    }
+    return ret;
+}
+
 [[nodiscard]] std::string_view BoardView::storage_get_root(Link link, std::uint16_t accessor) noexcept {
     if (!m_bdat)
         return {};
@@ -54,6 +201,15 @@ namespace smce {
     return it->root_dir;
 }
 
+/// Accounts for a change to a pin, for BoardView::changes_since and for the netlist wiring the board if any
+static void pin_changed(BoardData& bdat, std::size_t idx) noexcept {
+    bdat.mark_changed(bdat.pins[idx].generation);
+    bdat.mark_changed(bdat.pins_generation);
+    raise_sketch_events(bdat, pins_event);
+    if (bdat.pins_watched.load(boost::memory_order_relaxed))
+        bdat.pins_dirty[idx / 64].fetch_or(std::uint64_t{1} << idx % 64, boost::memory_order_release);
+}
+
 [[nodiscard]] bool VirtualAnalogDriver::exists() noexcept { return m_bdat && m_idx < m_bdat->pins.size(); }
 
 [[nodiscard]] bool VirtualAnalogDriver::can_read() noexcept { return exists() && m_bdat->pins[m_idx].can_analog_read; }
@@ -67,8 +223,11 @@ namespace smce {
 }
 
 void VirtualAnalogDriver::write(std::uint16_t value) noexcept {
-    if (exists())
-        m_bdat->pins[m_idx].value.store(value);
+    if (!exists())
+        return;
+    m_bdat->pins[m_idx].value.store(value);
+    pin_changed(*m_bdat, m_idx);
+    record_input(m_bdat, {InputKind::analog_write, m_bdat->pins[m_idx].id, value});
 }
 
 [[nodiscard]] bool VirtualDigitalDriver::exists() noexcept { return m_bdat && m_idx < m_bdat->pins.size(); }
@@ -84,8 +243,11 @@ void VirtualAnalogDriver::write(std::uint16_t value) noexcept {
 [[nodiscard]] bool VirtualDigitalDriver::read() noexcept { return exists() && m_bdat->pins[m_idx].value.load(); }
 
 void VirtualDigitalDriver::write(bool value) noexcept {
-    if (exists())
-        m_bdat->pins[m_idx].value.store(value ? 255 : 0);
+    if (!exists())
+        return;
+    m_bdat->pins[m_idx].value.store(value ? 255 : 0);
+    pin_changed(*m_bdat, m_idx);
+    record_input(m_bdat, {InputKind::digital_write, m_bdat->pins[m_idx].id, value});
 }
 
 [[nodiscard]] bool VirtualPin::exists() noexcept { return m_bdat && m_idx < m_bdat->pins.size(); }
@@ -95,8 +257,11 @@ void VirtualDigitalDriver::write(bool value) noexcept {
 }
 
 void VirtualPin::set_direction(DataDirection dir) noexcept {
-    if (exists() && !locked())
-        m_bdat->pins[m_idx].data_direction = static_cast<BoardData::Pin::DataDirection>(dir);
+    if (!exists() || locked())
+        return;
+    m_bdat->pins[m_idx].data_direction = static_cast<BoardData::Pin::DataDirection>(dir);
+    pin_changed(*m_bdat, m_idx);
+    record_input(m_bdat, {InputKind::pin_direction, m_bdat->pins[m_idx].id, static_cast<std::uint64_t>(dir)});
 }
 
 [[nodiscard]] auto VirtualPin::get_direction() noexcept -> DataDirection {
@@ -116,55 +281,79 @@ VirtualPin VirtualPins::operator[](std::size_t pin_id) noexcept {
     return {nullptr, std::size_t(-1)};
 }
 
+/**
+ * Ring carrying a buffer of a linked channel: rx receives from the peer's ring, tx transmits into this side's one
+ * \param link - receives the link segment; null for buffers which are not linked
+ **/
+static UartLinkRing* linked_ring(const BoardData::UartChannel& chan, bool rx, UartLinkData*& link) noexcept {
+    std::uint8_t side = 0;
+    link = find_uart_link(chan, side);
+    return link ? &link->rings[rx ? 1 - side : side] : nullptr;
+}
+
+/// Ring of a buffer which is not linked
+static ByteRing local_ring(BoardData::UartChannel& chan, bool rx) noexcept {
+    auto& buf = rx ? chan.rx : chan.tx;
+    return {buf.head, buf.tail, {buf.storage.data(), buf.storage.size()}, buf.storage.size(), &buf.busy_until,
+            chan.byte_time};
+}
+
+/**
+ * Ring backing a buffer; that of the link for linked channels
+ * \param link - receives the link segment; null for buffers which are not linked
+ **/
+static ByteRing buffer_ring(BoardData::UartChannel& chan, bool rx, UartLinkData*& link) noexcept {
+    auto* const ring = linked_ring(chan, rx, link);
+    return ring ? ring->view() : local_ring(chan, rx);
+}
+
+/// Accounts for bytes which were just committed to a buffer
+static void uart_written(BoardData& bdat, std::size_t index, bool rx, bool linked, std::size_t count) noexcept {
+    if (!count)
+        return;
+    bdat.mark_changed(bdat.uart_channels[index].generation);
+    // Bytes sent over a link are for the peer board rather than for the host
+    if (!rx && !linked)
+        raise_sketch_events(bdat, uart_tx_event);
+}
+
 [[nodiscard]] bool VirtualUartBuffer::exists() noexcept { return m_bdat && m_index < m_bdat->uart_channels.size(); }
 
 [[nodiscard]] std::size_t VirtualUartBuffer::max_size() noexcept {
-    // clang-format off
-    return exists() ? (m_dir == Direction::rx
-                           ? m_bdat->uart_channels[m_index].max_buffered_rx
-                           : m_bdat->uart_channels[m_index].max_buffered_tx) : 0;
-    // clang-format on
+    if (!exists())
+        return 0;
+    UartLinkData* link = nullptr;
+    return buffer_ring(m_bdat->uart_channels[m_index], m_dir == Direction::rx, link).capacity;
 }
 
 [[nodiscard]] std::size_t VirtualUartBuffer::size() noexcept {
     if (!exists())
         return 0;
-    auto& chan = m_bdat->uart_channels[m_index];
-    auto [d, mut] = [&] {
-        switch (m_dir) {
-        case Direction::rx:
-            return std::tie(chan.rx, chan.rx_mut);
-        case Direction::tx:
-            return std::tie(chan.tx, chan.tx_mut);
-        }
-        unreachable(); // GCOV_EXCL_LINE
-    }();
-    if (!mut.timed_lock(microsec_clock::universal_time() + boost::posix_time::seconds{1}))
-        return 0;
-    std::lock_guard lg{mut, std::adopt_lock};
-    const auto ret = d.size();
-    return ret;
+    UartLinkData* link = nullptr;
+    return buffer_ring(m_bdat->uart_channels[m_index], m_dir == Direction::rx, link).size();
 }
 
 std::size_t VirtualUartBuffer::read(std::span<char> buf) noexcept {
     if (!exists())
         return 0;
     auto& chan = m_bdat->uart_channels[m_index];
-    auto [d, mut, max_buffered] = [&] {
-        switch (m_dir) {
-        case Direction::rx:
-            return std::tie(chan.rx, chan.rx_mut, chan.max_buffered_rx);
-        case Direction::tx:
-            return std::tie(chan.tx, chan.tx_mut, chan.max_buffered_tx);
-        }
-        unreachable(); // GCOV_EXCL_LINE
-    }();
-    if (!mut.timed_lock(microsec_clock::universal_time() + boost::posix_time::seconds{1}))
+    const bool rx = m_dir == Direction::rx;
+    // The host writes rx and reads tx, while the board does the opposite
+    const auto source = rx ? Tracing::Source::board : Tracing::Source::host;
+    UartLinkData* link = nullptr;
+    auto ring = buffer_ring(chan, rx, link);
+    // Draining a linked tx would steal the bytes of the peer board
+    if (link && !rx)
         return 0;
+    trace(*m_bdat, source, Tracing::Phase::begin, "uart.read");
+    auto& mut = rx ? chan.rx_mut : chan.tx_mut;
+    if (!mut.timed_lock(microsec_clock::universal_time() + boost::posix_time::seconds{1}))
+        return trace(*m_bdat, source, Tracing::Phase::end, "uart.read"), 0;
     std::lock_guard lg{mut, std::adopt_lock};
-    const std::size_t count = std::min(d.size(), buf.size());
-    std::copy_n(d.begin(), count, buf.begin());
-    d.erase(d.begin(), d.begin() + count);
+    const auto count = ring.read(buf);
+    if (count)
+        m_bdat->mark_changed(chan.generation);
+    trace(*m_bdat, source, Tracing::Phase::end, "uart.read", count);
     return count;
 }
 
@@ -172,44 +361,120 @@ std::size_t VirtualUartBuffer::write(std::span<const char> buf) noexcept {
     if (!exists())
         return 0;
     auto& chan = m_bdat->uart_channels[m_index];
-    auto [d, mut, max_buffered] = [&] {
-        switch (m_dir) {
-        case Direction::rx:
-            return std::tie(chan.rx, chan.rx_mut, chan.max_buffered_rx);
-        case Direction::tx:
-            return std::tie(chan.tx, chan.tx_mut, chan.max_buffered_tx);
-        }
-        unreachable(); // GCOV_EXCL_LINE
-    }();
-    if (!mut.timed_lock(microsec_clock::universal_time() + boost::posix_time::seconds{1}))
+    const bool rx = m_dir == Direction::rx;
+    const auto source = rx ? Tracing::Source::host : Tracing::Source::board;
+    UartLinkData* link = nullptr;
+    auto ring = buffer_ring(chan, rx, link);
+    // The peer board is the only producer of a linked rx
+    if (link && rx)
         return 0;
-    std::lock_guard lg{mut, std::adopt_lock};
-    const std::size_t count = std::min(
-        std::clamp(max_buffered - d.size(), std::size_t{0}, static_cast<std::size_t>(max_buffered)), buf.size());
-    std::copy_n(buf.begin(), count, std::back_inserter(d));
+    trace(*m_bdat, source, Tracing::Phase::begin, "uart.write");
+    auto& mut = rx ? chan.rx_mut : chan.tx_mut;
+    if (!mut.timed_lock(microsec_clock::universal_time() + boost::posix_time::seconds{1}))
+        return trace(*m_bdat, source, Tracing::Phase::end, "uart.write"), 0;
+    std::size_t count;
+    {
+        std::lock_guard lg{mut, std::adopt_lock};
+        count = ring.write(buf);
+        uart_written(*m_bdat, m_index, rx, link != nullptr, count);
+    }
+    // Recorded outside of the buffer lock, which the board spins on
+    if (rx && count)
+        record_input(m_bdat, {InputKind::uart_rx_write, m_index, 0, std::as_bytes(buf.first(count))});
+    trace(*m_bdat, source, Tracing::Phase::end, "uart.write", count);
     return count;
 }
 
 [[nodiscard]] char VirtualUartBuffer::front() noexcept {
     if (!exists())
         return '\0';
+    UartLinkData* link = nullptr;
+    char ret = '\0';
+    buffer_ring(m_bdat->uart_channels[m_index], m_dir == Direction::rx, link).peek({&ret, 1});
+    return ret;
+}
+
+[[nodiscard]] std::array<std::span<const char>, 2> VirtualUartBuffer::peek() noexcept {
+    if (!exists())
+        return {};
+    const bool rx = m_dir == Direction::rx;
+    UartLinkData* link = nullptr;
+    const auto ring = buffer_ring(m_bdat->uart_channels[m_index], rx, link);
+    if (link && !rx)
+        return {};
+    const auto spans = ring.readable();
+    return {spans[0], spans[1]};
+}
+
+void VirtualUartBuffer::consume(std::size_t count) noexcept {
+    if (!exists())
+        return;
     auto& chan = m_bdat->uart_channels[m_index];
-    auto [d, mut] = [&] {
-        switch (m_dir) {
-        case Direction::rx:
-            return std::tie(chan.rx, chan.rx_mut);
-        case Direction::tx:
-            return std::tie(chan.tx, chan.tx_mut);
-        }
-        unreachable(); // GCOV_EXCL_LINE
-    }();
+    const bool rx = m_dir == Direction::rx;
+    UartLinkData* link = nullptr;
+    auto ring = buffer_ring(chan, rx, link);
+    if (link && !rx)
+        return;
+    // Serialized with read, which drains the same end of the ring
+    auto& mut = rx ? chan.rx_mut : chan.tx_mut;
     if (!mut.timed_lock(microsec_clock::universal_time() + boost::posix_time::seconds{1}))
-        return 0;
+        return;
     std::lock_guard lg{mut, std::adopt_lock};
-    if (d.empty())
-        return '\0';
-    const char ret = d.front();
-    return ret;
+    count = std::min(count, ring.size());
+    if (!count)
+        return;
+    ring.consume(count);
+    m_bdat->mark_changed(chan.generation);
+    trace(*m_bdat, rx ? Tracing::Source::board : Tracing::Source::host, Tracing::Phase::instant, "uart.consume", count);
+}
+
+[[nodiscard]] std::array<std::span<char>, 2> VirtualUartBuffer::prepare(std::size_t count) noexcept {
+    if (!exists())
+        return {};
+    const bool rx = m_dir == Direction::rx;
+    UartLinkData* link = nullptr;
+    const auto ring = buffer_ring(m_bdat->uart_channels[m_index], rx, link);
+    if (link && rx)
+        return {};
+    return ring.writable(count);
+}
+
+void VirtualUartBuffer::commit(std::size_t count) noexcept {
+    if (!exists())
+        return;
+    auto& chan = m_bdat->uart_channels[m_index];
+    const bool rx = m_dir == Direction::rx;
+    UartLinkData* link = nullptr;
+    auto ring = buffer_ring(chan, rx, link);
+    if (link && rx)
+        return;
+    // Serialized with write, which fills the same end of the ring
+    auto& mut = rx ? chan.rx_mut : chan.tx_mut;
+    if (!mut.timed_lock(microsec_clock::universal_time() + boost::posix_time::seconds{1}))
+        return;
+    // Committed bytes belong to the consumer once the lock is released, so they are recorded from a copy
+    std::vector<std::byte> recorded;
+    {
+        std::lock_guard lg{mut, std::adopt_lock};
+        const auto spans = ring.writable(count);
+        count = spans[0].size() + spans[1].size();
+        ring.commit(count);
+        uart_written(*m_bdat, m_index, rx, link != nullptr, count);
+        if (rx && count && recording_inputs()) {
+            try {
+                recorded.reserve(count);
+                for (const auto piece : spans)
+                    recorded.insert(recorded.end(), std::as_bytes(piece).begin(), std::as_bytes(piece).end());
+            } catch (const std::bad_alloc&) {
+                // Short of memory for the copy; record straight from the buffer rather than drop the bytes
+                for (const auto piece : spans)
+                    record_input(m_bdat, {InputKind::uart_rx_write, m_index, 0, std::as_bytes(piece)});
+            }
+        }
+    }
+    if (!recorded.empty())
+        record_input(m_bdat, {InputKind::uart_rx_write, m_index, 0, recorded});
+    trace(*m_bdat, rx ? Tracing::Source::host : Tracing::Source::board, Tracing::Phase::instant, "uart.commit", count);
 }
 
 [[nodiscard]] bool VirtualUart::exists() noexcept { return m_bdat && m_index < m_bdat->uart_channels.size(); }
@@ -219,8 +484,11 @@ std::size_t VirtualUartBuffer::write(std::span<const char> buf) noexcept {
 }
 
 void VirtualUart::set_active(bool value) noexcept {
-    if (exists())
-        m_bdat->uart_channels[m_index].active.store(value);
+    if (!exists())
+        return;
+    auto& chan = m_bdat->uart_channels[m_index];
+    chan.active.store(value);
+    m_bdat->mark_changed(chan.generation);
 }
 
 [[nodiscard]] VirtualUart VirtualUarts::operator[](std::size_t idx) noexcept {
@@ -254,6 +522,7 @@ void FrameBuffer::needs_horizontal_flip(bool val) noexcept {
     auto trans = m_bdat->frame_buffers[m_idx].transform.load();
     trans.horiz_flip = val;
     m_bdat->frame_buffers[m_idx].transform.store(trans);
+    m_bdat->mark_changed(m_bdat->frame_buffers[m_idx].generation);
 }
 
 [[nodiscard]] bool FrameBuffer::needs_vertical_flip() noexcept {
@@ -267,6 +536,7 @@ void FrameBuffer::needs_vertical_flip(bool val) noexcept {
     auto trans = m_bdat->frame_buffers[m_idx].transform.load();
     trans.vert_flip = val;
     m_bdat->frame_buffers[m_idx].transform.store(trans);
+    m_bdat->mark_changed(m_bdat->frame_buffers[m_idx].generation);
 }
 
 [[nodiscard]] std::uint16_t FrameBuffer::get_width() noexcept {
@@ -279,6 +549,7 @@ void FrameBuffer::set_width(std::uint16_t width) noexcept {
     auto& fb = m_bdat->frame_buffers[m_idx];
     fb.width = width;
     fb.data.resize(width * fb.height * 3);
+    m_bdat->mark_changed(fb.generation);
 }
 
 [[nodiscard]] std::uint16_t FrameBuffer::get_height() noexcept {
@@ -291,6 +562,7 @@ void FrameBuffer::set_height(std::uint16_t height) noexcept {
     auto& fb = m_bdat->frame_buffers[m_idx];
     fb.height = height;
     fb.data.resize(height * fb.width * 3);
+    m_bdat->mark_changed(fb.generation);
 }
 
 [[nodiscard]] std::uint8_t FrameBuffer::get_freq() noexcept {
@@ -301,6 +573,7 @@ void FrameBuffer::set_freq(std::uint8_t freq) noexcept {
     if (!exists())
         return;
     m_bdat->frame_buffers[m_idx].freq = freq;
+    m_bdat->mark_changed(m_bdat->frame_buffers[m_idx].generation);
 }
 
 bool FrameBuffer::write_rgb888(std::span<const std::byte> buf) {
@@ -311,8 +584,19 @@ bool FrameBuffer::write_rgb888(std::span<const std::byte> buf) {
     if (buf.size() != frame_buf.data.size())
         return false;
 
-    [[maybe_unused]] std::lock_guard lk{frame_buf.data_mut};
-    std::memcpy(frame_buf.data.data(), buf.data(), buf.size());
+    {
+        [[maybe_unused]] std::lock_guard lk{frame_buf.data_mut};
+        std::memcpy(frame_buf.data.data(), buf.data(), buf.size());
+    }
+    m_bdat->mark_changed(frame_buf.generation);
+    raise_sketch_events(*m_bdat, frame_buffers_event);
+    // Recorded outside of the frame lock, which the board spins on
+    record_input(m_bdat, {InputKind::framebuffer_rgb888, frame_buf.key,
+                          std::uint64_t{frame_buf.width.load()} << 16 | frame_buf.height.load(), buf});
+    // Camera frames are written by the host, screen frames by the board
+    const auto source = frame_buf.direction == BoardData::FrameBuffer::Direction::in ? Tracing::Source::host
+                                                                                      : Tracing::Source::board;
+    trace(*m_bdat, source, Tracing::Phase::instant, "framebuffer.write", frame_buf.key);
     return true;
 }
 
@@ -325,6 +609,9 @@ bool FrameBuffer::read_rgb888(std::span<std::byte> buf) {
         return false;
     [[maybe_unused]] std::lock_guard lk{frame_buf.data_mut};
     std::memcpy(buf.data(), frame_buf.data.data(), buf.size());
+    const auto source = frame_buf.direction == BoardData::FrameBuffer::Direction::out ? Tracing::Source::host
+                                                                                      : Tracing::Source::board;
+    trace(*m_bdat, source, Tracing::Phase::instant, "framebuffer.read", frame_buf.key);
     return true;
 }
 
@@ -341,18 +628,28 @@ bool FrameBuffer::write_rgb444(std::span<const std::byte> buf) {
     if (buf.size() != frame_buf.data.size() / 3 * 2)
         return false;
 
-    [[maybe_unused]] std::lock_guard lk{frame_buf.data_mut};
-
-    auto from = buf.begin();
-    auto to = frame_buf.data.begin();
-    while (from != buf.end()) {
-        const auto gb = *from++;
-        const auto xr = *from++;
-        *to++ = xr << 4;
-        *to++ = gb & std::byte{0xF0};
-        *to++ = gb << 4;
+    {
+        [[maybe_unused]] std::lock_guard lk{frame_buf.data_mut};
+
+        auto from = buf.begin();
+        auto to = frame_buf.data.begin();
+        while (from != buf.end()) {
+            const auto gb = *from++;
+            const auto xr = *from++;
+            *to++ = xr << 4;
+            *to++ = gb & std::byte{0xF0};
+            *to++ = gb << 4;
+        }
     }
-
+    m_bdat->mark_changed(frame_buf.generation);
+    raise_sketch_events(*m_bdat, frame_buffers_event);
+    // Recorded outside of the frame lock, which the board spins on
+    record_input(m_bdat, {InputKind::framebuffer_rgb444, frame_buf.key,
+                          std::uint64_t{frame_buf.width.load()} << 16 | frame_buf.height.load(), buf});
+
+    const auto source = frame_buf.direction == BoardData::FrameBuffer::Direction::in ? Tracing::Source::host
+                                                                                      : Tracing::Source::board;
+    trace(*m_bdat, source, Tracing::Phase::instant, "framebuffer.write", frame_buf.key);
     return true;
 }
 
@@ -375,6 +672,9 @@ bool FrameBuffer::read_rgb444(std::span<std::byte> buf) {
         *to++ = r >> 4;
     }
 
+    const auto source = frame_buf.direction == BoardData::FrameBuffer::Direction::out ? Tracing::Source::host
+                                                                                      : Tracing::Source::board;
+    trace(*m_bdat, source, Tracing::Phase::instant, "framebuffer.read", frame_buf.key);
     return true;
 }
 
@@ -391,4 +691,130 @@ FrameBuffer FrameBuffers::operator[](std::size_t key) noexcept {
     return {nullptr, std::size_t(-1)};
 }
 
+static std::uint64_t diagnostic_key(std::string_view site, std::string_view message) noexcept {
+    std::uint64_t hash = 0xcbf29ce484222325; // FNV-1a
+    const auto mix = [&](std::string_view sv) {
+        for (const char c : sv)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    };
+    mix(site);
+    mix({"", 1});
+    mix(message);
+    return hash ? hash : 1; // 0 marks free slots
+}
+
+std::uint64_t Diagnostics::report(std::string_view site, std::string_view message,
+                                  std::chrono::nanoseconds log_interval) noexcept {
+    if (!m_bdat)
+        return 0;
+    site = site.substr(0, StaticCharVec64::static_capacity);
+    message = message.substr(0, StaticCharVec64::static_capacity);
+    const auto key = diagnostic_key(site, message);
+    const std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now().time_since_epoch())
+                                 .count();
+
+    auto& table = m_bdat->diagnostics;
+    for (std::size_t probe = 0; probe < table.size(); ++probe) {
+        auto& entry = table[(key + probe) % table.size()];
+        std::uint64_t expected = 0;
+        if (entry.key.compare_exchange_strong(expected, key)) {
+            entry.site.assign(site.begin(), site.end());
+            entry.message.assign(message.begin(), message.end());
+            entry.ready.store(true);
+        } else if (expected != key) {
+            continue;
+        }
+
+        const auto count = ++entry.count;
+        auto last = entry.last_logged.load();
+        if (count != 1 && now - last < log_interval.count())
+            return 0;
+        return entry.last_logged.compare_exchange_strong(last, now) ? count : 0;
+    }
+
+    // The table is full: the occurrence goes uncounted, but its log still gets through, at least the first time
+    ++m_bdat->diagnostics_dropped;
+    auto& dropped = m_bdat->dropped_diagnostics[key % m_bdat->dropped_diagnostics.size()];
+    if (dropped.key.exchange(key) != key) {
+        dropped.last_logged.store(now);
+        return 1;
+    }
+    auto last = dropped.last_logged.load();
+    if (now - last < log_interval.count())
+        return 0;
+    return dropped.last_logged.compare_exchange_strong(last, now) ? 1 : 0;
+}
+
+std::vector<Diagnostics::Entry> Diagnostics::entries() {
+    if (!m_bdat)
+        return {};
+    std::vector<Entry> ret;
+    for (auto& entry : m_bdat->diagnostics) {
+        if (!entry.ready.load())
+            continue;
+        ret.push_back({{entry.site.data(), entry.site.size()},
+                       {entry.message.data(), entry.message.size()},
+                       entry.count.load()});
+    }
+    return ret;
+}
+
+std::uint64_t Diagnostics::dropped() noexcept { return m_bdat ? m_bdat->diagnostics_dropped.load() : 0; }
+
+[[nodiscard]] bool Tracing::enabled() noexcept { return m_bdat && m_bdat->tracing_enabled.load(); }
+
+void Tracing::set_enabled(bool enabled) noexcept {
+    if (m_bdat && !m_bdat->trace_rings.empty())
+        m_bdat->tracing_enabled.store(enabled);
+}
+
+void Tracing::record(Source source, Phase phase, std::string_view name, std::uint64_t arg) noexcept {
+    if (m_bdat)
+        trace(*m_bdat, source, phase, name, arg);
+}
+
+[[nodiscard]] std::vector<Tracing::Event> Tracing::events() {
+    if (!m_bdat)
+        return {};
+    constexpr auto relaxed = boost::memory_order_relaxed;
+    std::vector<Event> ret;
+    for (std::size_t src = 0; src < m_bdat->trace_rings.size(); ++src) {
+        for (auto& event : m_bdat->trace_rings[src].events) {
+            const auto seq = event.seq.load(boost::memory_order_acquire);
+            if (!seq)
+                continue;
+            Event copy{std::chrono::nanoseconds{event.ts_ns.load(relaxed)},
+                       Source{static_cast<std::uint8_t>(src)},
+                       Phase{static_cast<char>(event.phase.load(relaxed))},
+                       event.thread.load(relaxed),
+                       {},
+                       event.arg.load(relaxed)};
+            std::array<std::uint64_t, 3> packed_name{};
+            for (std::size_t i = 0; i < packed_name.size(); ++i)
+                packed_name[i] = event.name[i].load(relaxed);
+            const auto name_len = std::min<std::size_t>(event.name_len.load(relaxed), max_name_length);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (event.seq.load(relaxed) != seq)
+                continue; // overwritten while reading
+            copy.name.assign(reinterpret_cast<const char*>(packed_name.data()), name_len);
+            ret.push_back(std::move(copy));
+        }
+    }
+    std::stable_sort(ret.begin(), ret.end(),
+                     [](const Event& lhs, const Event& rhs) { return lhs.timestamp < rhs.timestamp; });
+    return ret;
+}
+
+[[nodiscard]] std::uint64_t Tracing::overwritten() noexcept {
+    if (!m_bdat)
+        return 0;
+    std::uint64_t ret = 0;
+    for (auto& ring : m_bdat->trace_rings) {
+        if (const auto head = ring.head.load(); head > ring.events.size())
+            ret += head - ring.events.size();
+    }
+    return ret;
+}
+
 } // namespace smce
@@ -0,0 +1,182 @@
+/*
+ *  Coroutines.cpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#include "SMCE/Coroutines.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <boost/predef.h>
+#if BOOST_OS_LINUX
+#    include <poll.h>
+#endif
+
+namespace smce {
+
+Task& Task::operator=(Task&& other) noexcept {
+    if (this != &other) {
+        if (m_handle)
+            m_handle.destroy();
+        m_handle = std::exchange(other.m_handle, {});
+    }
+    return *this;
+}
+
+Task::~Task() {
+    if (m_handle)
+        m_handle.destroy();
+}
+
+void Task::await_resume() {
+    if (m_handle && m_handle.promise().exception)
+        std::rethrow_exception(m_handle.promise().exception);
+}
+
+struct Scheduler::Internal {
+    struct Waiter {
+        Awaiter* awaiter;
+        std::coroutine_handle<> task;
+    };
+
+    std::vector<Task> tasks;                     // spawned tasks, owned until they complete
+    std::vector<std::coroutine_handle<>> starts; // spawned tasks yet to be started
+    std::vector<Waiter> waiters;
+    std::vector<Board*> boards;
+
+    /// Drops the completed tasks, handing out the first exception which escaped one
+    std::exception_ptr reap() noexcept {
+        std::exception_ptr ret;
+        std::erase_if(tasks, [&](const Task& task) {
+            if (!task.m_handle.done())
+                return false;
+            if (!ret)
+                ret = task.m_handle.promise().exception;
+            return true;
+        });
+        return ret;
+    }
+
+    /// Blocks until a watched board raises events, or until a given time
+    void wait_until(std::chrono::steady_clock::time_point deadline) {
+        const auto now = std::chrono::steady_clock::now();
+        if (deadline <= now)
+            return;
+        const auto timeout = std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+#if BOOST_OS_LINUX
+        std::vector<pollfd> fds;
+        for (auto* board : boards) {
+            if (const int fd = board->event_fd(); fd != -1)
+                fds.push_back({.fd = fd, .events = POLLIN, .revents = 0});
+        }
+        if (!fds.empty()) {
+            if (::poll(fds.data(), fds.size(), static_cast<int>(timeout.count())) > 0) {
+                for (auto* board : boards)
+                    [[maybe_unused]] const auto events = board->take_events();
+            }
+            return;
+        }
+#endif
+        // Nothing to wait on; sample again shortly
+        std::this_thread::sleep_for(std::min(timeout, std::chrono::milliseconds{1}));
+    }
+};
+
+void Awaiter::await_suspend(Task::Handle task) {
+    task.promise().scheduler->m_internal->waiters.push_back({this, task});
+}
+
+[[nodiscard]] bool EdgeAwaiter::poll() noexcept {
+    const bool level = m_pin.read();
+    if (level == m_level)
+        return false;
+    m_level = level;
+    return m_edge == Edge::any || level == (m_edge == Edge::rising);
+}
+
+[[nodiscard]] bool ExitAwaiter::poll() noexcept {
+    m_board.tick();
+    const auto status = m_board.status();
+    return status != Board::Status::running && status != Board::Status::suspended;
+}
+
+Scheduler::Scheduler() : m_internal{std::make_unique<Internal>()} {}
+
+Scheduler::~Scheduler() = default;
+
+void Scheduler::spawn(Task task) {
+    auto& in = *m_internal;
+    if (!task.m_handle)
+        return;
+    task.m_handle.promise().scheduler = this;
+    in.starts.reserve(in.starts.size() + 1);
+    in.starts.push_back(task.m_handle);
+    in.tasks.push_back(std::move(task));
+}
+
+void Scheduler::watch(Board& board) {
+    auto& in = *m_internal;
+    if (std::find(in.boards.begin(), in.boards.end(), &board) == in.boards.end())
+        in.boards.push_back(&board);
+}
+
+void Scheduler::unwatch(Board& board) noexcept { std::erase(m_internal->boards, &board); }
+
+std::size_t Scheduler::run_once(std::chrono::milliseconds max_wait) {
+    auto& in = *m_internal;
+    const auto pass = [&] {
+        std::size_t resumed = 0;
+        for (const auto task : std::exchange(in.starts, {})) {
+            task.resume();
+            ++resumed;
+        }
+        // Resumed tasks may suspend again, so they are only re-queued once the pass is over
+        const auto now = std::chrono::steady_clock::now();
+        auto waiters = std::exchange(in.waiters, {});
+        std::erase_if(waiters, [&](const Internal::Waiter& waiter) {
+            if (!waiter.awaiter->poll() && waiter.awaiter->deadline() > now)
+                return false;
+            waiter.task.resume();
+            ++resumed;
+            return true;
+        });
+        in.waiters.insert(in.waiters.end(), waiters.begin(), waiters.end());
+        return resumed;
+    };
+
+    auto resumed = pass();
+    if (!resumed && !in.waiters.empty()) {
+        auto deadline = std::chrono::steady_clock::now() + max_wait;
+        for (const auto& waiter : in.waiters)
+            deadline = std::min(deadline, waiter.awaiter->deadline());
+        in.wait_until(deadline);
+        resumed = pass();
+    }
+    if (const auto exception = in.reap())
+        std::rethrow_exception(exception);
+    return resumed;
+}
+
+void Scheduler::run() {
+    while (!m_internal->tasks.empty())
+        run_once();
+}
+
+[[nodiscard]] std::size_t Scheduler::size() const noexcept { return m_internal->tasks.size(); }
+
+} // namespace smce
@@ -0,0 +1,393 @@
+/*
+ *  InputRecording.cpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#include "SMCE/InputRecording.hpp"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "SMCE/internal/BoardData.hpp"
+#include "SMCE/internal/InputRecording.hpp"
+
+namespace smce {
+
+/**
+ * Leading part of a recording, followed by its chunks
+ * \note Fields are in host byte order, like board images
+ **/
+struct RecordingHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t header_size;
+};
+
+/**
+ * Leading part of a chunk, followed by `payload_size` bytes holding `event_count` events
+ * Events are laid out as: varint delta_ns, u8 kind, varint index, varint value, varint payload size, payload
+ * where delta_ns is relative to the previous event of the chunk, or to `base_ns` for the first one
+ **/
+struct RecordingChunkHeader {
+    std::uint32_t payload_size;
+    std::uint32_t event_count;
+    std::uint64_t base_ns; /// Time since the start of the recording
+};
+
+constexpr std::array<char, 8> recording_magic{'S', 'M', 'C', 'E', 'R', 'E', 'C', '\0'};
+constexpr std::uint32_t recording_version = 1;
+constexpr std::size_t chunk_flush_size = 64 * 1024;
+constexpr auto chunk_flush_period = std::chrono::milliseconds{100};
+constexpr std::size_t device_bank_count = boost::hana::size(device_field_bank_types);
+
+/// Calls `f(bank_index, bank)` for every device field bank holding values, which leaves out the mutexes
+template <class F>
+static void for_each_value_bank(DeviceFieldBanks& banks, F f) {
+    [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+        (..., [&] {
+            auto& bank = banks[boost::hana::size_c<Is>];
+            if constexpr (!std::is_same_v<typename std::remove_reference_t<decltype(bank)>::value_type,
+                                          IpcMovableMutex>)
+                f(Is, bank);
+        }());
+    }(std::make_index_sequence<device_bank_count>{});
+}
+
+static void write_varint(std::vector<std::byte>& out, std::uint64_t value) {
+    for (; value >= 0x80; value >>= 7)
+        out.push_back(std::byte(value | 0x80));
+    out.push_back(std::byte(value));
+}
+
+static std::optional<std::uint64_t> read_varint(std::span<const std::byte>& in) noexcept {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64 && !in.empty(); shift += 7) {
+        const auto byte = std::to_integer<std::uint64_t>(in.front());
+        in = in.subspan(1);
+        value |= (byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    return std::nullopt;
+}
+
+struct InputRecorder::Internal {
+    BoardData* bdat;
+    std::ofstream file;
+    std::chrono::milliseconds device_poll;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+    std::mutex mut;
+    std::condition_variable_any cv;
+    std::vector<std::byte> chunk;
+    /// Chunk being written out; only touched by the writer, see `write_chunk`
+    std::vector<std::byte> spare;
+    std::uint32_t chunk_events = 0;
+    bool flush_requested = false;
+    std::uint64_t chunk_base_ns = 0;
+    std::uint64_t last_ns = 0;
+    bool failed = false;
+    /// Bank contents as of the last poll; empty banks start out zeroed, like the ones of a fresh board
+    std::array<std::vector<std::byte>, device_bank_count> device_shadows;
+    std::jthread worker;
+
+    static std::mutex registry_mut;
+    static std::vector<Internal*> registry;
+
+    static void hook(const BoardData* bdat, const InputEvent& event) noexcept {
+        std::lock_guard rlk{registry_mut};
+        const auto it = std::find_if(registry.begin(), registry.end(), [=](Internal* i) { return i->bdat == bdat; });
+        if (it == registry.end())
+            return;
+        std::lock_guard lk{(*it)->mut};
+        (*it)->append(event);
+    }
+
+    /// \pre `mut` is held
+    void append(const InputEvent& event) noexcept try {
+        const auto now = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count());
+        if (!chunk_events)
+            chunk_base_ns = last_ns = now;
+        write_varint(chunk, now - last_ns);
+        chunk.push_back(std::byte{static_cast<std::uint8_t>(event.kind)});
+        write_varint(chunk, event.index);
+        write_varint(chunk, event.value);
+        write_varint(chunk, event.payload.size());
+        chunk.insert(chunk.end(), event.payload.begin(), event.payload.end());
+        last_ns = now;
+        ++chunk_events;
+        // Full chunks are written out by the worker, keeping file I/O away from the boards' hot paths
+        if (chunk.size() >= chunk_flush_size && !flush_requested) {
+            flush_requested = true;
+            cv.notify_one();
+        }
+    } catch (const std::bad_alloc&) {
+        failed = true;
+    }
+
+    /**
+     * Swaps the pending chunk out into `spare`
+     * \return header of the chunk, if it holds any event
+     * \pre `mut` is held
+     **/
+    std::optional<RecordingChunkHeader> take_chunk() noexcept {
+        flush_requested = false;
+        if (!chunk_events)
+            return std::nullopt;
+        const RecordingChunkHeader header{static_cast<std::uint32_t>(chunk.size()), chunk_events, chunk_base_ns};
+        chunk.swap(spare);
+        chunk_events = 0;
+        return header;
+    }
+
+    /**
+     * Writes the chunk last taken out to the file; stream failures stick and are reported by `stop`
+     * \pre Called by the worker, or once it has joined
+     **/
+    void write_chunk(const RecordingChunkHeader& header) noexcept {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(spare.data()), static_cast<std::streamsize>(spare.size()));
+        file.flush();
+        spare.clear();
+    }
+
+    /// Writes the pending chunk out, releasing `mut` meanwhile so that recording boards never wait on the file
+    void flush(std::unique_lock<std::mutex>& lk) noexcept {
+        const auto header = take_chunk();
+        if (!header)
+            return;
+        lk.unlock();
+        write_chunk(*header);
+        lk.lock();
+    }
+
+    /// \pre `mut` is held
+    void poll_devices() noexcept {
+        for_each_value_bank(bdat->banks, [&](std::size_t bank_idx, auto& bank) {
+            const auto bytes = std::as_bytes(std::span{bank.data(), bank.size()});
+            auto& shadow = device_shadows[bank_idx];
+            shadow.resize(bytes.size());
+            constexpr std::size_t elem_size = sizeof(bank[0]);
+            for (std::size_t i = 0; i < bank.size(); ++i) {
+                const auto elem = bytes.subspan(i * elem_size, elem_size);
+                if (std::memcmp(elem.data(), shadow.data() + i * elem_size, elem_size) == 0)
+                    continue;
+                std::memcpy(shadow.data() + i * elem_size, elem.data(), elem_size);
+                append({InputKind::device_store, bank_idx, i, elem});
+            }
+        });
+    }
+
+    void run(std::stop_token stop) noexcept {
+        std::unique_lock lk{mut};
+        auto next_flush = std::chrono::steady_clock::now() + chunk_flush_period;
+        while (!stop.stop_requested()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (device_poll.count())
+                poll_devices();
+            if (now >= next_flush || flush_requested) {
+                flush(lk);
+                next_flush = now + chunk_flush_period;
+            }
+            const auto wake = device_poll.count() ? std::min(next_flush, now + device_poll) : next_flush;
+            cv.wait_until(lk, stop, wake, [&] { return flush_requested; });
+        }
+    }
+};
+
+std::mutex InputRecorder::Internal::registry_mut;
+std::vector<InputRecorder::Internal*> InputRecorder::Internal::registry;
+
+InputRecorder::InputRecorder() noexcept = default;
+
+InputRecorder::~InputRecorder() { [[maybe_unused]] const auto ec = stop(); }
+
+std::error_code InputRecorder::start(BoardView view, const stdfs::path& location,
+                                     std::chrono::milliseconds device_poll) noexcept try {
+    if (!view.m_bdat || device_poll.count() < 0)
+        return std::make_error_code(std::errc::invalid_argument);
+    if (m_internal)
+        return std::make_error_code(std::errc::device_or_resource_busy);
+    std::lock_guard rlk{Internal::registry_mut};
+    if (std::any_of(Internal::registry.begin(), Internal::registry.end(),
+                    [&](Internal* i) { return i->bdat == view.m_bdat; }))
+        return std::make_error_code(std::errc::device_or_resource_busy);
+    {
+        std::error_code ec;
+        stdfs::create_directories(location.parent_path(), ec);
+        if (ec)
+            return ec;
+    }
+
+    auto internal = std::make_unique<Internal>();
+    internal->bdat = view.m_bdat;
+    internal->device_poll = device_poll;
+    internal->chunk.reserve(chunk_flush_size);
+    internal->spare.reserve(chunk_flush_size);
+    internal->file.open(location, std::ios::binary | std::ios::trunc);
+    const RecordingHeader header{recording_magic, recording_version, sizeof(RecordingHeader)};
+    internal->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!internal->file)
+        return std::make_error_code(std::errc::io_error);
+
+    Internal::registry.push_back(internal.get());
+    input_hook.store(&Internal::hook);
+    internal->worker = std::jthread{[i = internal.get()](std::stop_token stop) { i->run(std::move(stop)); }};
+    m_internal = std::move(internal);
+    return {};
+} catch (const std::bad_alloc&) {
+    return std::make_error_code(std::errc::not_enough_memory);
+} catch (const std::system_error& e) {
+    return e.code();
+}
+
+std::error_code InputRecorder::stop() noexcept {
+    if (!m_internal)
+        return {};
+    {
+        std::lock_guard rlk{Internal::registry_mut};
+        std::erase(Internal::registry, m_internal.get());
+        if (Internal::registry.empty())
+            input_hook.store(nullptr);
+    }
+    m_internal->worker.request_stop();
+    m_internal->worker.join();
+
+    std::unique_lock lk{m_internal->mut};
+    if (m_internal->device_poll.count())
+        m_internal->poll_devices();
+    m_internal->flush(lk);
+    m_internal->file.close();
+    const bool failed = m_internal->failed || !m_internal->file;
+    m_internal.reset();
+    return failed ? std::make_error_code(std::errc::io_error) : std::error_code{};
+}
+
+[[nodiscard]] bool InputRecorder::recording() const noexcept { return static_cast<bool>(m_internal); }
+
+/// Applies one recorded input to a board; inputs which do not fit it are dropped, like the views do
+static void replay_input(BoardView& view, BoardData& bdat, InputKind kind, std::uint64_t index, std::uint64_t value,
+                         std::span<const std::byte> payload) noexcept {
+    switch (kind) {
+    case InputKind::analog_write:
+        view.pins[index].analog().write(static_cast<std::uint16_t>(value));
+        break;
+    case InputKind::digital_write:
+        view.pins[index].digital().write(value);
+        break;
+    case InputKind::pin_direction:
+        view.pins[index].set_direction(static_cast<VirtualPin::DataDirection>(value));
+        break;
+    case InputKind::uart_rx_write: {
+        const auto chars = std::span{reinterpret_cast<const char*>(payload.data()), payload.size()};
+        view.uart_channels[index].rx().write(chars);
+        break;
+    }
+    case InputKind::framebuffer_rgb888:
+    case InputKind::framebuffer_rgb444: {
+        auto fb = view.frame_buffers[index];
+        fb.set_width(static_cast<std::uint16_t>(value >> 16));
+        fb.set_height(static_cast<std::uint16_t>(value));
+        if (kind == InputKind::framebuffer_rgb888)
+            fb.write_rgb888(payload);
+        else
+            fb.write_rgb444(payload);
+        break;
+    }
+    case InputKind::device_store:
+        for_each_value_bank(bdat.banks, [&](std::size_t bank_idx, auto& bank) {
+            using Value = typename std::remove_reference_t<decltype(bank)>::value_type;
+            if (bank_idx != index || value >= bank.size() || payload.size() != sizeof(Value))
+                return;
+            if constexpr (requires { bank[value].load(); }) {
+                typename Value::value_type stored;
+                std::memcpy(&stored, payload.data(), sizeof(stored));
+                bank[value].store(stored);
+            } else {
+                std::memcpy(&bank[value], payload.data(), sizeof(Value));
+            }
+        });
+        break;
+    }
+}
+
+std::error_code InputRecorder::replay(BoardView view, const stdfs::path& location, double speed,
+                                      std::stop_token stop) noexcept try {
+    if (!view.m_bdat || !(speed >= 0))
+        return std::make_error_code(std::errc::invalid_argument);
+
+    std::ifstream file{location, std::ios::binary};
+    if (!file)
+        return std::make_error_code(std::errc::io_error);
+    RecordingHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != recording_magic ||
+        header.version != recording_version || header.header_size != sizeof(RecordingHeader))
+        return std::make_error_code(std::errc::invalid_argument);
+
+    std::mutex mut;
+    std::unique_lock lk{mut};
+    std::condition_variable_any cv;
+    const auto origin = std::chrono::steady_clock::now();
+    std::vector<std::byte> payload;
+    for (RecordingChunkHeader chunk; file.read(reinterpret_cast<char*>(&chunk), sizeof(chunk));) {
+        payload.resize(chunk.payload_size);
+        // The last chunk may have been cut short by a crash of the recording process
+        if (!file.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size())))
+            break;
+
+        std::span<const std::byte> in = payload;
+        std::uint64_t ts_ns = chunk.base_ns;
+        for (std::uint32_t i = 0; i < chunk.event_count; ++i) {
+            const auto delta_ns = read_varint(in);
+            if (!delta_ns || in.empty())
+                return std::make_error_code(std::errc::invalid_argument);
+            const auto kind = static_cast<InputKind>(in.front());
+            in = in.subspan(1);
+            const auto index = read_varint(in);
+            const auto value = read_varint(in);
+            const auto size = read_varint(in);
+            if (!index || !value || !size || *size > in.size())
+                return std::make_error_code(std::errc::invalid_argument);
+            const auto event_payload = in.first(*size);
+            in = in.subspan(*size);
+
+            ts_ns += *delta_ns;
+            if (speed > 0) {
+                const auto due = origin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                              std::chrono::duration<double, std::nano>{ts_ns / speed});
+                cv.wait_until(lk, stop, due, [] { return false; });
+            }
+            if (stop.stop_requested())
+                return {};
+            replay_input(view, *view.m_bdat, kind, *index, *value, event_payload);
+        }
+    }
+    return {};
+} catch (const std::bad_alloc&) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+
+} // namespace smce
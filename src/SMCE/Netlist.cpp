@@ -0,0 +1,197 @@
+/*
+ *  Netlist.cpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#include "SMCE/Netlist.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include "SMCE/internal/BoardData.hpp"
+
+namespace smce {
+
+constexpr auto no_net = std::numeric_limits<std::uint32_t>::max();
+
+struct Netlist::Internal {
+    struct Member {
+        BoardData* bdat;
+        std::uint32_t pin; // index in BoardData::pins
+    };
+    struct WiredBoard {
+        BoardData* bdat;
+        std::vector<std::uint32_t> pin_nets; // net of each pin, by index
+    };
+
+    std::mutex mut;
+    std::vector<std::vector<Member>> nets;
+    std::vector<WiredBoard> boards;
+    std::jthread worker;
+
+    WiredBoard* find_board(const BoardData* bdat) noexcept {
+        const auto it =
+            std::find_if(boards.begin(), boards.end(), [=](const WiredBoard& wb) { return wb.bdat == bdat; });
+        return it != boards.end() ? &*it : nullptr;
+    }
+
+    void release_boards() noexcept {
+        for (auto& wb : boards)
+            wb.bdat->pins_watched.store(false);
+        boards.clear();
+        nets.clear();
+    }
+};
+
+Netlist::Netlist() noexcept = default;
+
+Netlist::~Netlist() { clear(); }
+
+std::error_code Netlist::connect(std::span<const Endpoint> endpoints) noexcept try {
+    if (!m_internal)
+        m_internal = std::make_unique<Internal>();
+    auto& in = *m_internal;
+    std::lock_guard lk{in.mut};
+    if (endpoints.size() < 2 || in.nets.size() == no_net)
+        return std::make_error_code(std::errc::invalid_argument);
+
+    std::vector<Internal::Member> members;
+    members.reserve(endpoints.size());
+    for (const auto& [board, pin_id] : endpoints) {
+        BoardData* const bdat = board.m_bdat;
+        if (!bdat)
+            return std::make_error_code(std::errc::invalid_argument);
+        const auto it = std::lower_bound(bdat->pins.begin(), bdat->pins.end(), pin_id,
+                                         [](const auto& pin, std::size_t pin_id) { return pin.id < pin_id; });
+        if (it == bdat->pins.end() || it->id != pin_id)
+            return std::make_error_code(std::errc::invalid_argument);
+        const Internal::Member member{bdat, static_cast<std::uint32_t>(std::distance(bdat->pins.begin(), it))};
+        if (const auto* wb = in.find_board(bdat); wb && wb->pin_nets[member.pin] != no_net)
+            return std::make_error_code(std::errc::invalid_argument);
+        if (std::any_of(members.begin(), members.end(),
+                        [&](const auto& m) { return m.bdat == member.bdat && m.pin == member.pin; }))
+            return std::make_error_code(std::errc::invalid_argument);
+        members.push_back(member);
+    }
+
+    // Claim the new boards all at once, so that a failure leaves the netlist as it was
+    std::vector<BoardData*> claimed;
+    for (const auto& member : members) {
+        if (in.find_board(member.bdat) || std::find(claimed.begin(), claimed.end(), member.bdat) != claimed.end())
+            continue;
+        bool expected = false;
+        if (!member.bdat->pins_watched.compare_exchange_strong(expected, true)) {
+            for (auto* bdat : claimed)
+                bdat->pins_watched.store(false);
+            return std::make_error_code(std::errc::device_or_resource_busy);
+        }
+        claimed.push_back(member.bdat);
+    }
+    in.boards.reserve(in.boards.size() + claimed.size());
+    for (auto* bdat : claimed)
+        in.boards.push_back({bdat, std::vector<std::uint32_t>(bdat->pins.size(), no_net)});
+
+    // Flag the pins of the net so that the next pass syncs them up
+    const auto net = static_cast<std::uint32_t>(in.nets.size());
+    for (const auto& member : members) {
+        in.find_board(member.bdat)->pin_nets[member.pin] = net;
+        member.bdat->pins_dirty[member.pin / 64].fetch_or(std::uint64_t{1} << member.pin % 64);
+    }
+    in.nets.push_back(std::move(members));
+    return {};
+} catch (const std::bad_alloc&) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+
+[[nodiscard]] std::size_t Netlist::size() const noexcept {
+    if (!m_internal)
+        return 0;
+    std::lock_guard lk{m_internal->mut};
+    return m_internal->nets.size();
+}
+
+void Netlist::clear() noexcept {
+    if (!m_internal)
+        return;
+    stop();
+    std::lock_guard lk{m_internal->mut};
+    m_internal->release_boards();
+}
+
+std::size_t Netlist::propagate() noexcept {
+    if (!m_internal)
+        return 0;
+    auto& in = *m_internal;
+    std::lock_guard lk{in.mut};
+    using Direction = BoardData::Pin::DataDirection;
+    std::size_t changed = 0;
+    for (auto& [bdat, pin_nets] : in.boards) {
+        for (std::size_t word = 0; word < bdat->pins_dirty.size(); ++word) {
+            for (auto bits = bdat->pins_dirty[word].exchange(0, boost::memory_order_acquire); bits; bits &= bits - 1) {
+                const auto pin = word * 64 + std::countr_zero(bits);
+                const auto net = pin_nets[pin];
+                if (net == no_net)
+                    continue;
+                const auto& source = bdat->pins[pin];
+                if (source.data_direction.load() != Direction::out)
+                    continue;
+                const auto value = source.value.load();
+                for (const auto& member : in.nets[net]) {
+                    auto& sink = member.bdat->pins[member.pin];
+                    if (&sink == &source || sink.data_direction.load() == Direction::out || sink.value.load() == value)
+                        continue;
+                    sink.value.store(value);
+                    member.bdat->mark_changed(sink.generation);
+                    member.bdat->mark_changed(member.bdat->pins_generation);
+                    ++changed;
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+std::error_code Netlist::start(std::chrono::microseconds period) noexcept try {
+    if (period.count() <= 0)
+        return std::make_error_code(std::errc::invalid_argument);
+    if (!m_internal)
+        m_internal = std::make_unique<Internal>();
+    if (m_internal->worker.joinable())
+        return std::make_error_code(std::errc::device_or_resource_busy);
+    m_internal->worker = std::jthread{[this, period](std::stop_token stop) {
+        for (auto next = std::chrono::steady_clock::now(); !stop.stop_requested(); next += period) {
+            propagate();
+            std::this_thread::sleep_until(next + period);
+        }
+    }};
+    return {};
+} catch (const std::system_error& e) {
+    return e.code();
+}
+
+void Netlist::stop() noexcept {
+    if (!m_internal || !m_internal->worker.joinable())
+        return;
+    m_internal->worker.request_stop();
+    m_internal->worker.join();
+}
+
+} // namespace smce
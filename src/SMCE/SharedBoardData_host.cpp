@@ -16,6 +16,16 @@
  *
  */
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "SMCE/Board.hpp"
 #include "SMCE/internal/SharedBoardData.hpp"
 
 namespace bip = boost::interprocess;
@@ -24,10 +34,119 @@ using ShmVoidAllocator = bip::allocator<void, ShmSegMan>;
 
 namespace smce {
 
+/// Stand-in for any member in the aggregate initialization of \ref field_count
+struct AnyField {
+    template <class T>
+    operator T() const; // NOLINT(google-explicit-constructor)
+};
+
+/// Number of members of an aggregate
+template <class T, class... Fields>
+consteval std::size_t field_count() {
+    if constexpr (requires { T{Fields{}..., AnyField{}}; })
+        return field_count<T, Fields..., AnyField>();
+    else
+        return sizeof...(Fields);
+}
+
+// Members added to these also need to make it into config_hash below, unless they stay out of the segment as
+// scheduling and spawn_method do; update the counts once they have
+static_assert(field_count<BoardConfig>() == 11);
+static_assert(field_count<BoardConfig::GpioDrivers>() == 3);
+static_assert(field_count<BoardConfig::GpioDrivers::DigitalDriver>() == 2);
+static_assert(field_count<BoardConfig::GpioDrivers::AnalogDriver>() == 2);
+static_assert(field_count<BoardConfig::UartChannel>() == 9);
+static_assert(field_count<BoardConfig::SecureDigitalStorage>() == 2);
+static_assert(field_count<BoardConfig::FrameBuffer>() == 2);
+static_assert(field_count<BoardConfig::LoopPacing>() == 3);
+static_assert(field_count<BoardConfig::BoardDevice>() == 2);
+
+/// FNV-1a of every part of a configuration which ends up in the segment
+static std::uint64_t config_hash(const BoardConfig& bconf) {
+    std::uint64_t hash = 0xcbf29ce484222325;
+    const auto mix_bytes = [&](const void* data, std::size_t size) {
+        for (const auto* it = static_cast<const unsigned char*>(data); size--; ++it)
+            hash = (hash ^ *it) * 0x100000001b3;
+    };
+    const auto mix = [&](const auto& value) {
+        using T = std::remove_cvref_t<decltype(value)>;
+        if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            const std::string_view str = value;
+            mix_bytes(str.data(), str.size());
+            hash = (hash ^ 0xFF) * 0x100000001b3; // field separator
+        } else {
+            static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+            mix_bytes(&value, sizeof(value));
+        }
+    };
+    const auto mix_opt = [&](const auto& opt) {
+        mix(opt.has_value());
+        if (opt)
+            mix(*opt);
+    };
+
+    mix(bconf.pins.size());
+    for (const auto pin : bconf.pins)
+        mix(pin);
+    mix(bconf.gpio_drivers.size());
+    for (const auto& driver : bconf.gpio_drivers) {
+        mix(driver.pin_id);
+        mix(driver.digital_driver.has_value());
+        if (driver.digital_driver) {
+            mix(driver.digital_driver->board_read);
+            mix(driver.digital_driver->board_write);
+        }
+        mix(driver.analog_driver.has_value());
+        if (driver.analog_driver) {
+            mix(driver.analog_driver->board_read);
+            mix(driver.analog_driver->board_write);
+        }
+    }
+    mix(bconf.uart_channels.size());
+    for (const auto& uart : bconf.uart_channels) {
+        mix_opt(uart.rx_pin_override);
+        mix_opt(uart.tx_pin_override);
+        mix(uart.baud_rate);
+        mix(uart.rx_buffer_length);
+        mix(uart.tx_buffer_length);
+        mix(uart.flushing_threshold);
+        mix(uart.flush_on_newline);
+        mix(uart.paced);
+        mix(uart.frame_bits);
+    }
+    mix(bconf.sd_cards.size());
+    for (const auto& sd : bconf.sd_cards) {
+        mix(sd.cspin);
+        mix(sd.root_dir.generic_string());
+    }
+    mix(bconf.frame_buffers.size());
+    for (const auto& fb : bconf.frame_buffers) {
+        mix(fb.key);
+        mix(fb.direction);
+    }
+    mix(bconf.board_devices.size());
+    for (const auto& bd : bconf.board_devices) {
+        mix(bd.spec.name());
+        mix(bd.spec.version());
+        mix(bd.count);
+        for (const auto [name, type] : bd.spec) {
+            mix(name);
+            mix(type);
+        }
+    }
+    mix(bconf.delay_spin_threshold.count());
+    mix(bconf.loop_pacing.policy);
+    mix(bconf.loop_pacing.rate);
+    mix(bconf.loop_pacing.max_backoff.count());
+    mix(bconf.tracing);
+    return hash;
+}
+
 bool SharedBoardData::configure(std::string_view seg_name, const BoardConfig& bconf) {
     reset();
     m_master = true;
     m_name = seg_name;
+    m_config_hash = config_hash(bconf);
 
     // TODO compute required allocation size
 
@@ -36,4 +155,159 @@ bool SharedBoardData::configure(std::string_view seg_name, const BoardConfig& bc
     return true;
 }
 
+/**
+ * Leading part of a board image, followed by its extent table and the bytes of those extents
+ * Offset pointers are relative to their own address, so a byte-for-byte copy of a segment is valid wherever it gets
+ * mapped, as long as every object in it ends up at the same offset
+ **/
+struct BoardImageHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint64_t layout;
+    std::uint64_t config; // hash of the BoardConfig the board was configured with
+    std::uint64_t segment_size;
+    std::uint64_t board_data_offset;
+    std::uint64_t extent_count;
+    std::uint64_t payload_size;
+};
+
+/// Non-zero stretch of the segment; anything outside of the extents is zero-filled
+struct BoardImageExtent {
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+constexpr std::array<char, 8> board_image_magic{'S', 'M', 'C', 'E', 'I', 'M', 'G', '\0'};
+constexpr std::uint32_t board_image_version = 2;
+constexpr std::uint64_t board_data_layout = sizeof(BoardData) << 8 | alignof(BoardData);
+
+std::error_code SharedBoardData::save_image(std::vector<std::byte>& image) {
+    if (!m_bd)
+        return board_image_error::invalid_state;
+
+    const auto* const base = static_cast<const std::byte*>(m_shm.get_address());
+    const auto* const end = base + m_shm.get_size();
+    const auto is_set = [](std::byte b) { return b != std::byte{}; };
+
+    // The segment starts out zero-filled and stays mostly so; shorter gaps are not worth an extent of their own
+    constexpr std::ptrdiff_t min_gap = 64;
+    std::vector<BoardImageExtent> extents;
+    std::uint64_t payload_size = 0;
+    for (auto it = std::find_if(base, end, is_set); it != end;) {
+        auto run_end = std::find(it, end, std::byte{});
+        auto next = std::find_if(run_end, end, is_set);
+        while (next != end && next - run_end < min_gap) {
+            run_end = std::find(next, end, std::byte{});
+            next = std::find_if(run_end, end, is_set);
+        }
+        extents.push_back({static_cast<std::uint64_t>(it - base), static_cast<std::uint64_t>(run_end - it)});
+        payload_size += extents.back().size;
+        it = next;
+    }
+
+    const BoardImageHeader header{
+        .magic = board_image_magic,
+        .version = board_image_version,
+        .header_size = sizeof(BoardImageHeader),
+        .layout = board_data_layout,
+        .config = m_config_hash,
+        .segment_size = static_cast<std::uint64_t>(end - base),
+        .board_data_offset = static_cast<std::uint64_t>(reinterpret_cast<const std::byte*>(m_bd) - base),
+        .extent_count = extents.size(),
+        .payload_size = payload_size,
+    };
+    const std::size_t table_size = extents.size() * sizeof(BoardImageExtent);
+    image.resize(sizeof(header) + table_size + payload_size);
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + sizeof(header), extents.data(), table_size);
+    auto* payload = image.data() + sizeof(header) + table_size;
+    for (const auto& extent : extents) {
+        std::memcpy(payload, base + extent.offset, extent.size);
+        payload += extent.size;
+    }
+    return {};
+}
+
+std::error_code SharedBoardData::load_image(std::span<const std::byte> image) {
+    if (!m_bd)
+        return board_image_error::invalid_state;
+
+    BoardImageHeader header;
+    if (image.size() < sizeof(header))
+        return board_image_error::malformed;
+    std::memcpy(&header, image.data(), sizeof(header));
+    if (header.magic != board_image_magic || header.version != board_image_version ||
+        header.header_size != sizeof(header))
+        return board_image_error::malformed;
+    const auto body = image.subspan(sizeof(header));
+    if (header.extent_count > body.size() / sizeof(BoardImageExtent) ||
+        header.payload_size != body.size() - header.extent_count * sizeof(BoardImageExtent))
+        return board_image_error::malformed;
+
+    auto* const base = static_cast<std::byte*>(m_shm.get_address());
+    const std::size_t size = m_shm.get_size();
+    const auto board_data_offset = static_cast<std::uint64_t>(reinterpret_cast<std::byte*>(m_bd) - base);
+    if (header.layout != board_data_layout || header.config != m_config_hash || header.segment_size != size ||
+        header.board_data_offset != board_data_offset)
+        return board_image_error::incompatible;
+
+    std::vector<BoardImageExtent> extents(header.extent_count);
+    std::memcpy(extents.data(), body.data(), extents.size() * sizeof(BoardImageExtent));
+    std::uint64_t payload_size = 0;
+    for (const auto& extent : extents) {
+        if (extent.offset > size || extent.size > size - extent.offset)
+            return board_image_error::malformed;
+        payload_size += extent.size;
+    }
+    if (payload_size != header.payload_size)
+        return board_image_error::malformed;
+
+    // Links and netlists belong to the live board rather than to its state
+    std::vector<std::tuple<StaticCharVec64, std::uint8_t, std::uint32_t>> links;
+    for (const auto& uart : m_bd->uart_channels)
+        links.emplace_back(uart.link, uart.link_side, uart.link_seq.load());
+    const bool pins_watched = m_bd->pins_watched.load();
+    const auto generation = m_bd->generation.load();
+
+    std::memset(base, 0, size);
+    const auto* payload = body.data() + extents.size() * sizeof(BoardImageExtent);
+    for (const auto& extent : extents) {
+        std::memcpy(base + extent.offset, payload, extent.size);
+        payload += extent.size;
+    }
+
+    // Whoever held a lock when the image was captured is not around anymore, and neither are its clock readings;
+    // bytes still on the wire back then have arrived by now
+    for (std::size_t i = 0; auto& uart : m_bd->uart_channels) {
+        std::construct_at(&uart.rx_mut);
+        std::construct_at(&uart.tx_mut);
+        uart.rx.busy_until.store(0);
+        uart.tx.busy_until.store(0);
+        if (i < links.size())
+            std::tie(uart.link, uart.link_side, uart.link_seq) = links[i];
+        ++i;
+    }
+    m_bd->pins_watched.store(pins_watched);
+    for (auto& fb : m_bd->frame_buffers)
+        std::construct_at(&fb.data_mut);
+    constexpr auto mutex_bank_idx =
+        boost::hana::index_if(device_field_bank_types, boost::hana::equal.to(boost::hana::type_c<IpcMovableMutex>));
+    for (auto& mut : m_bd->banks[mutex_bank_idx.value()])
+        std::construct_at(&mut);
+
+    // Everything may differ from what hosts last synced, whichever generation they synced at
+    m_bd->generation.store(std::max(generation, m_bd->generation.load()));
+    for (auto& pin : m_bd->pins)
+        m_bd->mark_changed(pin.generation);
+    m_bd->mark_changed(m_bd->pins_generation);
+    for (auto& uart : m_bd->uart_channels)
+        m_bd->mark_changed(uart.generation);
+    for (auto& fb : m_bd->frame_buffers)
+        m_bd->mark_changed(fb.generation);
+    for (auto& stamp : m_bd->device_generations)
+        m_bd->mark_changed(stamp);
+    return {};
+}
+
 } // namespace smce
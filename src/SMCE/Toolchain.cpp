@@ -18,9 +18,18 @@
 
 #include <SMCE/Toolchain.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <system_error>
+#include <boost/interprocess/sync/file_lock.hpp>
 #include <boost/predef.h>
 #if BOOST_OS_WINDOWS
 #    include <boost/process/windows.hpp>
@@ -30,10 +39,13 @@
 #    include <ShlObj.h>
 #endif
 
+#include <SMCE/Board.hpp>
+#include <SMCE/BoardConf.hpp>
 #include <SMCE/PluginManifest.hpp>
 #include <SMCE/SMCE_iface.h>
 #include <SMCE/Sketch.hpp>
 #include <SMCE/SketchConf.hpp>
+#include <SMCE/Uuid.hpp>
 #include <SMCE/internal/utils.hpp>
 
 using namespace std::literals;
@@ -69,6 +81,12 @@ struct toolchain_error_category : public std::error_category {
             return "CMake configure failed";
         case toolchain_error::build_failed:
             return "CMake build failed";
+        case toolchain_error::compile_cancelled:
+            return "Compilation cancelled";
+        case toolchain_error::profile_missing:
+            return "No profile recorded for the sketch";
+        case toolchain_error::training_failed:
+            return "Training run of the instrumented sketch failed";
         default:
             return "smce.toolchain error";
         }
@@ -92,8 +110,72 @@ const std::error_category& get_exec_ctx_error_category() noexcept {
     return cat;
 }
 
+struct CompileState {
+    std::atomic<CompilePhase> phase = CompilePhase::configuring;
+    std::atomic<bool> cancelled = false;
+    std::mutex group_mtx;
+    bp::group* active_group = nullptr; /// processes to kill on cancellation; guarded by group_mtx
+    Toolchain::LogSink log_sink;
+    std::error_code result; /// published by the store of CompilePhase::done
+};
+
 } // namespace detail
 
+/// Registers a process group to be killed on cancellation, for the lifetime of this guard
+class ActiveGroupGuard {
+    detail::CompileState& m_state;
+
+  public:
+    /// \pre state.group_mtx is held by the caller
+    ActiveGroupGuard(detail::CompileState& state, bp::group& group) noexcept : m_state{state} {
+        m_state.active_group = &group;
+    }
+    ~ActiveGroupGuard() {
+        std::lock_guard lk{m_state.group_mtx};
+        m_state.active_group->detach();
+        m_state.active_group = nullptr;
+    }
+    ActiveGroupGuard(const ActiveGroupGuard&) = delete;
+    ActiveGroupGuard& operator=(const ActiveGroupGuard&) = delete;
+};
+
+CompileHandle::CompileHandle() noexcept = default;
+CompileHandle::CompileHandle(CompileHandle&&) noexcept = default;
+
+CompileHandle& CompileHandle::operator=(CompileHandle&& other) noexcept {
+    if (m_worker.joinable())
+        m_worker.join();
+    m_state = std::move(other.m_state);
+    m_worker = std::move(other.m_worker);
+    return *this;
+}
+
+CompileHandle::~CompileHandle() {
+    if (m_worker.joinable())
+        m_worker.join();
+}
+
+CompilePhase CompileHandle::phase() const noexcept {
+    return m_state ? m_state->phase.load() : CompilePhase::done;
+}
+
+void CompileHandle::cancel() noexcept {
+    if (!m_state)
+        return;
+    m_state->cancelled = true;
+    std::lock_guard lk{m_state->group_mtx};
+    if (m_state->active_group && m_state->active_group->valid()) {
+        std::error_code ec;
+        m_state->active_group->terminate(ec);
+    }
+}
+
+std::error_code CompileHandle::wait() noexcept {
+    if (m_worker.joinable())
+        m_worker.join();
+    return m_state ? m_state->result : toolchain_error::generic;
+}
+
 std::error_code make_error_code(toolchain_error ev) noexcept {
     return std::error_code{static_cast<std::underlying_type<toolchain_error>::type>(ev),
                            detail::get_exec_ctx_error_category()};
@@ -178,35 +260,235 @@ SMCE_INTERNAL stdfs::path find_cmake_in_bundle() {
 
 #endif
 
+/**
+ * Results of the environment probing, persisted in the resource directory
+ * so that new Toolchain instances do not need to spawn CMake again.
+ * Invalidated when PATH changes or when any of the recorded binaries is modified.
+ **/
+struct ToolchainFingerprint {
+    std::string path_env;
+    std::string cmake_path;
+    std::string cmake_mtime;
+    std::string cmake_version; /// first line of `cmake --version`
+    std::string ninja_path;    /// empty if not found
+    std::string ninja_mtime;
+};
+
+constexpr std::string_view fingerprint_filename = "toolchain.fingerprint";
+
+SMCE_INTERNAL std::string mtime_of(const stdfs::path& path) noexcept {
+    std::error_code ec;
+    const auto mtime = stdfs::last_write_time(path, ec);
+    return ec ? std::string{} : std::to_string(mtime.time_since_epoch().count());
+}
+
+SMCE_INTERNAL std::string current_path_env() {
+    const char* const path_env = std::getenv("PATH");
+    return path_env ? path_env : "";
+}
+
+SMCE_INTERNAL std::optional<ToolchainFingerprint> read_fingerprint(const stdfs::path& res_dir) {
+    std::ifstream f{res_dir / fingerprint_filename};
+    if (!f)
+        return std::nullopt;
+
+    ToolchainFingerprint fp;
+    const std::pair<std::string_view, std::string*> fields[] = {
+        {"path_env", &fp.path_env},           {"cmake_path", &fp.cmake_path}, {"cmake_mtime", &fp.cmake_mtime},
+        {"cmake_version", &fp.cmake_version}, {"ninja_path", &fp.ninja_path}, {"ninja_mtime", &fp.ninja_mtime},
+    };
+    for (std::string line; std::getline(f, line);) {
+        const auto eq = line.find('=');
+        if (eq == std::string::npos)
+            return std::nullopt;
+        const auto key = std::string_view{line}.substr(0, eq);
+        for (const auto& [name, field] : fields) {
+            if (name == key)
+                *field = line.substr(eq + 1);
+        }
+    }
+
+    if (fp.path_env != current_path_env())
+        return std::nullopt;
+    if (fp.cmake_path.empty() || fp.cmake_mtime.empty() || fp.cmake_mtime != mtime_of(fp.cmake_path))
+        return std::nullopt;
+    if (!fp.cmake_version.starts_with("cmake"))
+        return std::nullopt;
+    if (fp.ninja_mtime != (fp.ninja_path.empty() ? std::string{} : mtime_of(fp.ninja_path)))
+        return std::nullopt;
+    return fp;
+}
+
+SMCE_INTERNAL void write_fingerprint(const stdfs::path& res_dir, const ToolchainFingerprint& fp) noexcept {
+    // Write-then-rename so that concurrent readers never observe a partial file
+    const auto final_path = res_dir / fingerprint_filename;
+    auto tmp_path = final_path;
+    tmp_path += "." + Uuid::generate().to_hex();
+    {
+        std::ofstream f{tmp_path};
+        f << "path_env=" << fp.path_env << '\n';
+        f << "cmake_path=" << fp.cmake_path << '\n';
+        f << "cmake_mtime=" << fp.cmake_mtime << '\n';
+        f << "cmake_version=" << fp.cmake_version << '\n';
+        f << "ninja_path=" << fp.ninja_path << '\n';
+        f << "ninja_mtime=" << fp.ninja_mtime << '\n';
+        if (!f)
+            return;
+    }
+    std::error_code ec;
+    stdfs::rename(tmp_path, final_path, ec);
+    if (ec)
+        stdfs::remove(tmp_path, ec);
+}
+
+SMCE_INTERNAL std::string find_ninja() { return bp::search_path("ninja").string(); }
+
 Toolchain::Toolchain(stdfs::path resources_dir) noexcept : m_res_dir{std::move(resources_dir)} {
     m_build_log.reserve(4096);
 }
 
-std::error_code Toolchain::do_configure(Sketch& sketch) noexcept {
-    const auto sketch_hexid = sketch.m_uuid.to_hex();
+/// FNV-1a over the sketch sources and the parts of its config which affect code generation
+SMCE_INTERNAL std::optional<std::string> sketch_content_hash(const Sketch& sketch, const SketchConfig& conf) {
+    std::uint64_t hash = 0xcbf29ce484222325;
+    const auto feed = [&](std::string_view bytes) {
+        for (const char c : bytes) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3;
+        }
+        hash ^= 0xFF; // field separator
+        hash *= 0x100000001b3;
+    };
+
+    feed(conf.fqbn);
+    feed(conf.profile == SketchConfig::Profile::performance ? "performance" : "standard");
+    for (const auto& pm : conf.plugins) {
+        feed(pm.name);
+        feed(pm.version);
+        feed(pm.uri);
+        feed(pm.patch_uri);
+    }
+
+    // A single-file sketch is only that file, whatever else sits next to it
+    std::error_code ec;
+    const auto& source = sketch.get_source();
+    const bool is_dir = stdfs::is_directory(source, ec);
+    if (ec)
+        return std::nullopt;
+    const auto sketch_dir = is_dir ? source : source.parent_path();
+    std::vector<stdfs::path> files;
+    if (is_dir) {
+        for (auto it = stdfs::recursive_directory_iterator{sketch_dir, ec}; !ec && it != stdfs::end(it);
+             it.increment(ec)) {
+            if (it->is_regular_file(ec))
+                files.push_back(it->path());
+        }
+    } else {
+        files.push_back(source);
+    }
+    if (ec)
+        return std::nullopt;
+    std::sort(files.begin(), files.end());
+
+    for (const auto& file : files) {
+        feed(file.lexically_relative(sketch_dir).generic_string());
+        std::ifstream f{file, std::ios::binary};
+        if (!f)
+            return std::nullopt;
+        feed(std::string{std::istreambuf_iterator<char>{f}, std::istreambuf_iterator<char>{}});
+    }
+
+    constexpr char hex_digits[] = "0123456789ABCDEF";
+    std::string ret(16, '0');
+    for (auto& digit : ret) {
+        digit = hex_digits[hash >> 60];
+        hash <<= 4;
+    }
+    return ret;
+}
+
+SMCE_INTERNAL bool has_profile_data(const stdfs::path& profile_dir) {
+    std::error_code ec;
+    for (auto it = stdfs::recursive_directory_iterator{profile_dir, ec}; !ec && it != stdfs::end(it);
+         it.increment(ec)) {
+        const auto ext = it->path().extension();
+        if (ext == ".gcda" || ext == ".profraw")
+            return true;
+    }
+    return false;
+}
+
+void Toolchain::log_line(detail::CompileState& state, std::string&& line) noexcept {
+    line += '\n';
+    if (state.log_sink)
+        state.log_sink(line);
+
+    [[maybe_unused]] std::lock_guard lk{m_build_log_mtx};
+    m_build_log += line;
+    if (m_build_log.size() > max_build_log_size) {
+        // Drop a quarter at once to keep trimming amortized, and cut on a line boundary
+        const auto cut = m_build_log.find('\n', m_build_log.size() - max_build_log_size * 3 / 4);
+        m_build_log.erase(0, cut == std::string::npos ? m_build_log.size() : cut + 1);
+    }
+}
+
+std::error_code Toolchain::do_configure(Sketch& sketch, detail::CompileState& state) noexcept {
+    const std::string sketch_hexid = sketch.m_uuid.to_hex();
+    std::string comp_hexid = sketch_hexid;
+    std::string pgo_mode;
+    stdfs::path pgo_dir;
+    if (sketch.m_conf.pgo != SketchConfig::Pgo::off) {
+        const auto hash = sketch_content_hash(sketch, sketch.m_conf);
+        if (!hash)
+            return toolchain_error::sketch_invalid;
+        // Both builds of a PGO cycle need identical source and object paths for the profile to apply, so they share
+        // a build directory named after the sketch contents, out of which each sketch gets its own executable copied
+        comp_hexid = "pgo-" + *hash;
+        pgo_dir = m_res_dir / "pgo" / *hash;
+        if (sketch.m_conf.pgo == SketchConfig::Pgo::instrument) {
+            pgo_mode = "instrument";
+            std::error_code ec;
+            stdfs::create_directories(pgo_dir, ec);
+            if (ec)
+                return ec;
+        } else {
+            pgo_mode = "optimize";
+            if (!has_profile_data(pgo_dir))
+                return toolchain_error::profile_missing;
+        }
+    }
     sketch.m_tmpdir = this->m_res_dir / "tmp" / sketch_hexid;
+    sketch.m_compdir = this->m_res_dir / "tmp" / comp_hexid;
 
-    {
+    for (const auto& dir : {sketch.m_tmpdir, sketch.m_compdir}) {
         std::error_code ec;
-        stdfs::create_directories(sketch.m_tmpdir, ec);
+        stdfs::create_directories(dir, ec);
         if (ec)
             return ec;
     }
 
 #if !BOOST_OS_WINDOWS
     const char* const generator_override = std::getenv("CMAKE_GENERATOR");
-    const char* const generator =
-        generator_override ? generator_override : (!bp::search_path("ninja").empty() ? "Ninja" : "");
+    std::string generator;
+    if (generator_override)
+        generator = generator_override;
+    else if (const auto fp = read_fingerprint(m_res_dir))
+        generator = fp->ninja_path.empty() ? "" : "Ninja";
+    else
+        generator = find_ninja().empty() ? "" : "Ninja";
 #endif
 
-    write_devices_specs(sketch.m_conf, sketch.m_tmpdir);
+    write_devices_specs(sketch.m_conf, sketch.m_compdir);
 
-    if (const auto ec = write_manifests(sketch.m_conf, sketch.m_tmpdir))
+    if (const auto ec = write_manifests(sketch.m_conf, sketch.m_compdir))
         return ec;
     ProcessedLibs libs = process_libraries(sketch.m_conf);
 
     namespace bp = boost::process;
     bp::ipstream cmake_conf_out;
+    bp::group cmake_group;
+    std::unique_lock group_lk{state.group_mtx};
+    if (state.cancelled)
+        return toolchain_error::compile_cancelled;
     // clang-format off
     auto cmake_config = bp::child{
         m_cmake_path,
@@ -214,18 +496,24 @@ std::error_code Toolchain::do_configure(Sketch& sketch) noexcept {
         bp::env["CMAKE_GENERATOR"] = generator,
 #endif
         "-DSMCE_DIR=" + m_res_dir.string(),
-        "-DSKETCH_HEXID=" + sketch_hexid,
+        "-DSKETCH_HEXID=" + comp_hexid,
         "-DSKETCH_FQBN=" + sketch.m_conf.fqbn,
         "-DSKETCH_PATH=" + stdfs::absolute(sketch.m_source).generic_string(),
+        "-DSKETCH_PROFILE="s + (sketch.m_conf.profile == SketchConfig::Profile::performance ? "performance" : ""),
+        "-DSKETCH_PGO=" + pgo_mode,
+        "-DSKETCH_PGO_DIR=" + pgo_dir.generic_string(),
         std::move(libs.pp_remote_arg),
         "-P",
         m_res_dir.string() + "/RtResources/SMCE/share/CMake/Scripts/ConfigureSketch.cmake",
-        (bp::std_out & bp::std_err) > cmake_conf_out
+        (bp::std_out & bp::std_err) > cmake_conf_out,
+        cmake_group
 #if BOOST_OS_WINDOWS
        , bp::windows::create_no_window
 #endif
     };
     // clang-format on
+    ActiveGroupGuard active_group{state, cmake_group};
+    group_lk.unlock();
 
     {
         std::string line;
@@ -236,40 +524,77 @@ std::error_code Toolchain::do_configure(Sketch& sketch) noexcept {
                 sketch.m_executable = std::move(line);
                 break;
             }
-            [[maybe_unused]] std::lock_guard lk{m_build_log_mtx};
-            (m_build_log += line) += '\n';
+            log_line(state, std::move(line));
         }
     }
 
     cmake_config.join();
+    if (state.cancelled)
+        return toolchain_error::compile_cancelled;
     if (cmake_config.native_exit_code() != 0)
         return toolchain_error::configure_failed;
     return {};
 }
 
-std::error_code Toolchain::do_build(Sketch& sketch) noexcept {
+/// Copies an executable built in a shared directory into a directory of its own, so that later builds leave it alone
+SMCE_INTERNAL std::error_code copy_executable(const stdfs::path& executable, const stdfs::path& dest_dir) noexcept {
+    std::error_code ec;
+    stdfs::create_directories(dest_dir, ec);
+    if (ec)
+        return ec;
+#if BOOST_OS_WINDOWS
+    // The runtime library gets linked next to the executable
+    for (auto it = stdfs::directory_iterator{executable.parent_path(), ec}; !ec && it != stdfs::end(it);
+         it.increment(ec)) {
+        if (it->path().extension() == ".dll")
+            stdfs::copy_file(it->path(), dest_dir / it->path().filename(), stdfs::copy_options::overwrite_existing, ec);
+    }
+    if (ec)
+        return ec;
+#endif
+    stdfs::copy_file(executable, dest_dir / executable.filename(), stdfs::copy_options::overwrite_existing, ec);
+    return ec;
+}
+
+std::error_code Toolchain::do_build(Sketch& sketch, detail::CompileState& state) noexcept {
+    state.phase = CompilePhase::building;
+
     bp::ipstream cmake_build_out;
+    bp::group cmake_group;
+    std::unique_lock group_lk{state.group_mtx};
+    if (state.cancelled)
+        return toolchain_error::compile_cancelled;
     // clang-format off
     auto cmake_build = bp::child{
 #if BOOST_OS_WINDOWS
         bp::env["MSBUILDDISABLENODEREUSE"] = "1", // MSBuild "feature" which uses your child processes as potential daemons, forever
 #endif
         m_cmake_path,
-        "--build", (sketch.m_tmpdir / "build").string(),
+        "--build", (sketch.m_compdir / "build").string(),
         "--config", "Release",
-        (bp::std_out & bp::std_err) > cmake_build_out
+        (bp::std_out & bp::std_err) > cmake_build_out,
+        cmake_group
 #if BOOST_OS_WINDOWS
        , bp::windows::create_no_window
 #endif
     };
     // clang-format on
+    ActiveGroupGuard active_group{state, cmake_group};
+    group_lk.unlock();
 
     for (std::string line; std::getline(cmake_build_out, line);) {
-        [[maybe_unused]] std::lock_guard lk{m_build_log_mtx};
-        (m_build_log += line) += '\n';
+        // Preprocessing is a custom command of the sketch build; follow it through the generator's output
+        if (line.find("Preprocessing sketch") != std::string::npos)
+            state.phase = CompilePhase::preprocessing;
+        else if (state.phase == CompilePhase::preprocessing &&
+                 (line.find("Building") != std::string::npos || line.find("Linking") != std::string::npos))
+            state.phase = CompilePhase::building;
+        log_line(state, std::move(line));
     }
 
     cmake_build.join();
+    if (state.cancelled)
+        return toolchain_error::compile_cancelled;
     if (cmake_build.native_exit_code() != 0)
         return toolchain_error::build_failed;
 
@@ -279,6 +604,12 @@ std::error_code Toolchain::do_build(Sketch& sketch) noexcept {
         return ec;
     if (!binary_exists)
         return toolchain_error::build_failed;
+    if (sketch.m_compdir != sketch.m_tmpdir) {
+        const auto bin_dir = sketch.m_tmpdir / "bin";
+        if (const auto ec = copy_executable(sketch.m_executable, bin_dir))
+            return ec;
+        sketch.m_executable = bin_dir / sketch.m_executable.filename();
+    }
     return {};
 }
 
@@ -298,6 +629,12 @@ std::error_code Toolchain::do_build(Sketch& sketch) noexcept {
     else if (ec)
         return ec;
 
+    if (const auto fp = read_fingerprint(m_res_dir);
+        fp && (m_cmake_path == "cmake" || m_cmake_path == fp->cmake_path)) {
+        m_cmake_path = fp->cmake_path;
+        return {};
+    }
+
     if (m_cmake_path != "cmake") {
         if (std::error_code ec; stdfs::is_empty(m_cmake_path, ec))
             return toolchain_error::cmake_not_found;
@@ -339,10 +676,82 @@ std::error_code Toolchain::do_build(Sketch& sketch) noexcept {
     if (!line.starts_with("cmake"))
         return toolchain_error::cmake_unknown_output;
 
+    ToolchainFingerprint fp;
+    fp.path_env = current_path_env();
+    fp.cmake_path = m_cmake_path;
+    fp.cmake_mtime = mtime_of(m_cmake_path);
+    fp.cmake_version = std::move(line);
+    fp.ninja_path = find_ninja();
+    if (!fp.ninja_path.empty())
+        fp.ninja_mtime = mtime_of(fp.ninja_path);
+    if (!fp.cmake_mtime.empty())
+        write_fingerprint(m_res_dir, fp);
+
     return {};
 }
 
 std::error_code Toolchain::compile(Sketch& sketch) noexcept {
+    detail::CompileState state;
+    return do_compile(sketch, state);
+}
+
+bool Toolchain::has_profile(const Sketch& sketch) noexcept {
+    const auto hash = sketch_content_hash(sketch, sketch.m_conf);
+    return hash && has_profile_data(m_res_dir / "pgo" / *hash);
+}
+
+std::error_code Toolchain::compile_pgo(Sketch& sketch, const BoardConfig& training_board,
+                                       std::chrono::milliseconds training_duration) noexcept {
+    if (!has_profile(sketch)) {
+        auto instrumented_conf = sketch.m_conf;
+        instrumented_conf.pgo = SketchConfig::Pgo::instrument;
+        Sketch instrumented{sketch.m_source, std::move(instrumented_conf)};
+        if (const auto ec = compile(instrumented))
+            return ec;
+
+        // Profiles get written when the sketch exits, hence the graceful stop
+        Board board{};
+        if (!board.configure(training_board) || !board.attach_sketch(instrumented) || !board.start())
+            return toolchain_error::training_failed;
+        std::this_thread::sleep_for(training_duration);
+        const bool stopped = board.stop();
+        if (!stopped)
+            board.terminate();
+        if (!stopped || !has_profile(instrumented))
+            return toolchain_error::training_failed;
+    }
+
+    sketch.m_conf.pgo = SketchConfig::Pgo::optimize;
+    return compile(sketch);
+}
+
+CompileHandle Toolchain::compile_async(Sketch& sketch, LogSink log_sink) noexcept {
+    CompileHandle ret;
+    try {
+        ret.m_state = std::make_shared<detail::CompileState>();
+        ret.m_state->log_sink = std::move(log_sink);
+        ret.m_worker = std::thread{[this, &sketch, state = ret.m_state] {
+            state->result = do_compile(sketch, *state);
+            state->phase = CompilePhase::done;
+        }};
+    } catch (const std::system_error& e) {
+        if (ret.m_state) {
+            ret.m_state->result = e.code();
+            ret.m_state->phase = CompilePhase::done;
+        }
+    } catch (...) {
+        if (ret.m_state) {
+            ret.m_state->result = toolchain_error::generic;
+            ret.m_state->phase = CompilePhase::done;
+        }
+    }
+    return ret;
+}
+
+/// Serializes the builds of this process in PGO build directories; file locks do not exclude threads of one process
+static std::mutex pgo_build_dirs_mtx;
+
+std::error_code Toolchain::do_compile(Sketch& sketch, detail::CompileState& state) noexcept {
     sketch.m_built = false;
     std::error_code ec;
 
@@ -355,10 +764,38 @@ std::error_code Toolchain::compile(Sketch& sketch) noexcept {
     if (sketch.m_conf.fqbn.empty())
         return toolchain_error::sketch_invalid;
 
-    ec = do_configure(sketch);
-    if (ec)
-        return ec;
-    ec = do_build(sketch);
+    // Builds of a PGO cycle share a directory named after the sketch contents (see do_configure); they take turns
+    // using it, threads and processes alike, and each of them removes it once its executable got copied out
+    const bool pgo = sketch.m_conf.pgo != SketchConfig::Pgo::off;
+    std::unique_lock<std::mutex> pgo_lk;
+    boost::interprocess::file_lock pgo_flock;
+    if (pgo) {
+        const auto hash = sketch_content_hash(sketch, sketch.m_conf);
+        if (!hash)
+            return toolchain_error::sketch_invalid;
+        const auto lock_path = m_res_dir / "tmp" / ("pgo-" + *hash + ".lock");
+        stdfs::create_directories(lock_path.parent_path(), ec);
+        if (ec)
+            return ec;
+        std::ofstream{lock_path, std::ios::app};
+        pgo_lk = std::unique_lock{pgo_build_dirs_mtx};
+        try {
+            pgo_flock = boost::interprocess::file_lock{lock_path.string().c_str()};
+            pgo_flock.lock();
+        } catch (const boost::interprocess::interprocess_exception&) {
+            return std::make_error_code(std::errc::no_lock_available);
+        }
+    }
+
+    state.phase = CompilePhase::configuring;
+    sketch.m_compdir.clear();
+    ec = do_configure(sketch, state);
+    if (!ec)
+        ec = do_build(sketch, state);
+    if (pgo && !sketch.m_compdir.empty()) {
+        [[maybe_unused]] std::error_code rm_ec;
+        stdfs::remove_all(sketch.m_compdir, rm_ec);
+    }
     if (ec)
         return ec;
 
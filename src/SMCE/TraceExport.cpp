@@ -0,0 +1,96 @@
+/*
+ *  TraceExport.cpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#include "SMCE/TraceExport.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <ostream>
+#include <string_view>
+
+namespace smce {
+
+static void write_json_string(std::ostream& os, std::string_view str) {
+    os << '"';
+    for (const char c : str) {
+        switch (c) {
+        case '"':
+            os << "\\\"";
+            break;
+        case '\\':
+            os << "\\\\";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                std::array<char, 7> escaped{};
+                std::snprintf(escaped.data(), escaped.size(), "\\u%04x", static_cast<unsigned>(c));
+                os << escaped.data();
+            } else {
+                os << c;
+            }
+        }
+    }
+    os << '"';
+}
+
+std::error_code export_chrome_trace(std::span<const Tracing::Event> events, stdfs::path location) noexcept try {
+    {
+        std::error_code ec;
+        stdfs::create_directories(location.parent_path(), ec);
+        if (ec)
+            return ec;
+    }
+
+    std::ofstream file{location};
+    if (!file)
+        return std::make_error_code(std::errc::io_error);
+
+    constexpr std::array<std::string_view, 2> process_names{"Host", "Board"};
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (std::size_t pid = 0; pid < process_names.size(); ++pid) {
+        file << (pid ? "," : "") << "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+             << ",\"args\":{\"name\":\"" << process_names[pid] << "\"}}";
+    }
+
+    const auto origin = events.empty() ? std::chrono::nanoseconds{} : events.front().timestamp;
+    for (const auto& event : events) {
+        file << ",\n{\"name\":";
+        write_json_string(file, event.name);
+        // Chrome expects microseconds; keep the nanosecond precision as decimals
+        const auto ts = (event.timestamp - origin).count();
+        file << ",\"ph\":\"" << static_cast<char>(event.phase) << "\",\"ts\":" << ts / 1000 << '.';
+        std::array<char, 4> decimals{};
+        std::snprintf(decimals.data(), decimals.size(), "%03lld", static_cast<long long>(ts % 1000));
+        file << decimals.data() << ",\"pid\":" << static_cast<unsigned>(event.source) << ",\"tid\":" << event.thread;
+        if (event.phase == Tracing::Phase::instant)
+            file << ",\"s\":\"t\"";
+        file << ",\"args\":{\"arg\":" << event.arg << "}}";
+    }
+    file << "\n]}\n";
+
+    if (!file)
+        return std::make_error_code(std::errc::io_error);
+    return {};
+} catch (const std::bad_alloc&) {
+    return std::make_error_code(std::errc::not_enough_memory);
+}
+
+} // namespace smce
@@ -0,0 +1,163 @@
+/*
+ *  UartLink.cpp
+ *  Copyright 2022 ItJustWorksTM
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#include "SMCE/internal/UartLink.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+
+namespace bip = boost::interprocess;
+
+namespace smce {
+
+namespace {
+struct MappedLink {
+    std::string name;
+    bip::shared_memory_object shm;
+    bip::mapped_region region;
+};
+
+// Links mapped by this process; hosts keep theirs until the link is released, sketches for their whole lifetime
+std::mutex mapped_links_mut;
+std::vector<std::shared_ptr<MappedLink>> mapped_links;
+} // namespace
+
+/// Removes a link name without allocating; names are bounded by the channel field holding them
+static void remove_link_name(std::string_view name) noexcept {
+    constexpr std::size_t max_length = StaticCharVec64::static_capacity;
+    std::array<char, max_length + 1> cname{};
+    std::copy_n(name.begin(), std::min(name.size(), max_length), cname.begin());
+    bip::shared_memory_object::remove(cname.data());
+}
+
+static std::shared_ptr<UartLinkData> as_link_data(const std::shared_ptr<MappedLink>& link) noexcept {
+    return {link, static_cast<UartLinkData*>(link->region.get_address())};
+}
+
+std::shared_ptr<UartLinkData> create_uart_link(std::string_view name, std::array<std::size_t, 2> capacities,
+                                               std::uint64_t byte_time) noexcept {
+    bool created = false;
+    try {
+        auto link = std::make_shared<MappedLink>();
+        link->name = name;
+        link->shm = bip::shared_memory_object{bip::create_only, link->name.c_str(), bip::read_write};
+        created = true;
+        link->shm.truncate(sizeof(UartLinkData));
+        link->region = bip::mapped_region{link->shm, bip::read_write};
+        auto* const data = new (link->region.get_address()) UartLinkData{};
+        for (std::size_t i = 0; i < capacities.size(); ++i) {
+            data->rings[i].capacity = static_cast<std::uint32_t>(std::min(capacities[i], UartLinkRing::storage_size));
+            data->rings[i].byte_time = byte_time;
+        }
+
+        std::lock_guard lk{mapped_links_mut};
+        mapped_links.push_back(link);
+        return as_link_data(link);
+    } catch (const bip::interprocess_exception&) {
+    } catch (const std::bad_alloc&) {
+    }
+    if (created)
+        remove_link_name(name);
+    return nullptr;
+}
+
+/// Maps a link segment into this process unless it already is
+static std::shared_ptr<MappedLink> map_uart_link(std::string_view name) {
+    std::lock_guard lk{mapped_links_mut};
+    const auto it = std::find_if(mapped_links.begin(), mapped_links.end(),
+                                 [&](const std::shared_ptr<MappedLink>& link) { return link->name == name; });
+    if (it != mapped_links.end())
+        return *it;
+
+    auto link = std::make_shared<MappedLink>();
+    link->name = name;
+    link->shm = bip::shared_memory_object{bip::open_only, link->name.c_str(), bip::read_write};
+    link->region = bip::mapped_region{link->shm, bip::read_write};
+    if (link->region.get_size() < sizeof(UartLinkData))
+        return nullptr;
+    mapped_links.push_back(link);
+    return link;
+}
+
+void set_uart_link(BoardData::UartChannel& chan, std::string_view name, std::uint8_t side) noexcept {
+    const auto seq = chan.link_seq.load();
+    chan.link_seq.store(seq + 1);
+    std::atomic_thread_fence(std::memory_order_release);
+    chan.link.assign(name.begin(), name.begin() + std::min(name.size(), chan.link.capacity()));
+    chan.link_side = side;
+    chan.link_seq.store(seq + 2);
+}
+
+UartLinkData* find_uart_link(const BoardData::UartChannel& chan, std::uint8_t& side) noexcept try {
+    // The host may rewrite the link under us; the name is copied out and only trusted if the sequence did not move
+    const auto seq = chan.link_seq.load();
+    if (seq % 2)
+        return nullptr;
+    std::array<char, StaticCharVec64::static_capacity> name_buf;
+    const auto name_size = std::min(chan.link.size(), name_buf.size());
+    std::copy_n(chan.link.data(), name_size, name_buf.begin());
+    side = chan.link_side;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (chan.link_seq.load() != seq)
+        return nullptr;
+    const std::string_view name{name_buf.data(), name_size};
+
+    // Links of the channels this thread went through last; a hit costs neither the lock nor a reference count
+    struct CachedLink {
+        const BoardData::UartChannel* chan = nullptr;
+        std::shared_ptr<MappedLink> link;
+    };
+    thread_local std::array<CachedLink, 4> cache;
+    thread_local std::size_t next_evicted = 0;
+
+    auto it = std::find_if(cache.begin(), cache.end(), [&](const CachedLink& e) { return e.chan == &chan; });
+    if (name.empty()) {
+        // Disconnected; our mapping of the segment goes with it
+        if (it != cache.end())
+            *it = {};
+        return nullptr;
+    }
+    if (it != cache.end() && it->link && it->link->name == name)
+        return static_cast<UartLinkData*>(it->link->region.get_address());
+    if (it == cache.end())
+        it = cache.begin() + next_evicted++ % cache.size();
+    *it = {&chan, map_uart_link(name)};
+    return it->link ? static_cast<UartLinkData*>(it->link->region.get_address()) : nullptr;
+} catch (const bip::interprocess_exception&) {
+    return nullptr;
+} catch (const std::bad_alloc&) {
+    return nullptr;
+}
+
+void release_uart_link(std::string_view name) noexcept {
+    {
+        std::lock_guard lk{mapped_links_mut};
+        std::erase_if(mapped_links, [&](const std::shared_ptr<MappedLink>& link) { return link->name == name; });
+    }
+    remove_link_name(name);
+}
+
+} // namespace smce
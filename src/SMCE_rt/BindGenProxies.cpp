@@ -16,7 +16,9 @@
  *
  */
 
+#include <boost/hana/index_if.hpp>
 #include "SMCE/internal/BoardData.hpp"
+#include "SMCE/internal/BoardEvents.hpp"
 #include "SMCE_rt/SMCE_proxies.hpp"
 
 using A8 = smce::IpcAtomicValue<std::uint8_t>;
@@ -29,23 +31,51 @@ using Mtx = smce::IpcMovableMutex;
 
 namespace smce_rt {
 
+/// Stamps the bank of a field which was just stored to, for BoardView::changes_since, and wakes the host up
+template <class Field>
+static void stored(void* board) noexcept {
+    constexpr auto bank_idx =
+        *boost::hana::index_if(smce::device_field_bank_types, boost::hana::equal.to(boost::hana::type_c<Field>));
+    auto& bdat = *static_cast<smce::BoardData*>(board);
+    bdat.mark_changed(bdat.device_generations[bank_idx]);
+    smce::raise_sketch_events(bdat, smce::devices_event);
+}
+
 std::uint8_t AtomicU8::load() noexcept { return static_cast<A8*>(m_ptr)->load(); }
-void AtomicU8::store(std::uint8_t v) noexcept { static_cast<A8*>(m_ptr)->store(v); }
+void AtomicU8::store(std::uint8_t v) noexcept {
+    static_cast<A8*>(m_ptr)->store(v);
+    stored<A8>(m_board);
+}
 
 std::uint16_t AtomicU16::load() noexcept { return static_cast<A16*>(m_ptr)->load(); }
-void AtomicU16::store(std::uint16_t v) noexcept { static_cast<A16*>(m_ptr)->store(v); }
+void AtomicU16::store(std::uint16_t v) noexcept {
+    static_cast<A16*>(m_ptr)->store(v);
+    stored<A16>(m_board);
+}
 
 std::uint32_t AtomicU32::load() noexcept { return static_cast<A32*>(m_ptr)->load(); }
-void AtomicU32::store(std::uint32_t v) noexcept { static_cast<A32*>(m_ptr)->store(v); }
+void AtomicU32::store(std::uint32_t v) noexcept {
+    static_cast<A32*>(m_ptr)->store(v);
+    stored<A32>(m_board);
+}
 
 std::uint64_t AtomicU64::load() noexcept { return static_cast<A64*>(m_ptr)->load(); }
-void AtomicU64::store(std::uint64_t v) noexcept { static_cast<A64*>(m_ptr)->store(v); }
+void AtomicU64::store(std::uint64_t v) noexcept {
+    static_cast<A64*>(m_ptr)->store(v);
+    stored<A64>(m_board);
+}
 
 float AtomicF32::load() noexcept { return static_cast<F32*>(m_ptr)->load(); }
-void AtomicF32::store(float v) noexcept { static_cast<F32*>(m_ptr)->store(v); }
+void AtomicF32::store(float v) noexcept {
+    static_cast<F32*>(m_ptr)->store(v);
+    stored<F32>(m_board);
+}
 
 double AtomicF64::load() noexcept { return static_cast<F64*>(m_ptr)->load(); }
-void AtomicF64::store(double v) noexcept { static_cast<F64*>(m_ptr)->store(v); }
+void AtomicF64::store(double v) noexcept {
+    static_cast<F64*>(m_ptr)->store(v);
+    stored<F64>(m_board);
+}
 
 void Mutex::lock() { static_cast<Mtx*>(m_ptr)->lock(); }
 bool Mutex::try_lock() { return static_cast<Mtx*>(m_ptr)->try_lock(); }
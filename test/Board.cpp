@@ -16,10 +16,18 @@
  *
  */
 
+#include <array>
 #include <chrono>
 #include <fstream>
 #include <future>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#    include <poll.h>
+#    include <unistd.h>
+#endif
 #include <catch2/catch_test_macros.hpp>
 #include "SMCE/Board.hpp"
 #include "SMCE/Sketch.hpp"
@@ -95,6 +103,386 @@ TEST_CASE("Mixed INO/C++ sources", "[Board]") {
     REQUIRE_FALSE(ec);
 }
 
+TEST_CASE("Board performance profile", "[Board]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "pins",
+                    {.fqbn = "arduino:avr:nano", .profile = smce::SketchConfig::Profile::performance}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board br{};
+    REQUIRE(br.configure({.pins = {0, 2}, .gpio_drivers = {{0, {{true, false}}, {}}, {2, {{false, true}}, {}}}}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.start());
+    auto bv = br.view();
+    REQUIRE(bv.valid());
+    auto pin0d = bv.pins[0].digital();
+    auto pin2d = bv.pins[2].digital();
+    pin0d.write(false);
+    test_pin_delayable(pin2d, true, 16384, 1ms);
+    pin0d.write(true);
+    test_pin_delayable(pin2d, false, 16384, 1ms);
+    REQUIRE(br.stop());
+}
+
+TEST_CASE("Board loop pacing", "[Board]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch pins{SKETCHES_PATH "pins", {.fqbn = "arduino:avr:nano"}};
+    auto ec = tc.compile(pins);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Sketch noop{SKETCHES_PATH "noop", {.fqbn = "arduino:avr:nano"}};
+    ec = tc.compile(noop);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+
+    using Policy = smce::BoardConfig::LoopPacing::Policy;
+    const auto measure_rate = [](smce::Board& br) {
+        std::this_thread::sleep_for(1s);
+        return br.view().loop_rate();
+    };
+
+    smce::Board fixed{};
+    REQUIRE(fixed.configure({.pins = {0, 2},
+                             .gpio_drivers = {{0, {{true, false}}, {}}, {2, {{false, true}}, {}}},
+                             .loop_pacing = {.policy = Policy::fixed_rate, .rate = 100}}));
+    REQUIRE(fixed.attach_sketch(pins));
+    REQUIRE(fixed.start());
+    const auto fixed_rate = measure_rate(fixed);
+    REQUIRE(fixed_rate > 50);
+    REQUIRE(fixed_rate < 105);
+    REQUIRE(fixed.stop());
+
+    // noop performs no I/O at all, so it should settle on the longest backoff
+    smce::Board adaptive{};
+    REQUIRE(adaptive.configure({.loop_pacing = {.policy = Policy::adaptive, .max_backoff = 10ms}}));
+    REQUIRE(adaptive.attach_sketch(noop));
+    REQUIRE(adaptive.start());
+    const auto adaptive_rate = measure_rate(adaptive);
+    REQUIRE(adaptive_rate > 0);
+    REQUIRE(adaptive_rate < 105);
+    REQUIRE(adaptive.stop());
+
+    // Polling for input which never comes is no I/O either
+    smce::Sketch uart{SKETCHES_PATH "uart", {.fqbn = "arduino:avr:nano"}};
+    ec = tc.compile(uart);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board polling{};
+    REQUIRE(polling.configure(
+        {.uart_channels = {{}}, .loop_pacing = {.policy = Policy::adaptive, .max_backoff = 10ms}}));
+    REQUIRE(polling.attach_sketch(uart));
+    REQUIRE(polling.start());
+    const auto polling_rate = measure_rate(polling);
+    REQUIRE(polling_rate > 0);
+    REQUIRE(polling_rate < 105);
+    REQUIRE(polling.stop());
+}
+
+TEST_CASE("Board delay accuracy", "[Board]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "delay", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+
+    // The final stretch of each 2ms delay gets spun through
+    smce::Board br{};
+    REQUIRE(br.configure({.uart_channels = {{}}, .delay_spin_threshold = 1ms}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.start());
+    auto uart = br.view().uart_channels[0];
+    std::string out;
+    std::vector<unsigned long> lengths;
+    for (int ticks = 16'000; lengths.size() < 32; std::this_thread::sleep_for(1ms)) {
+        if (ticks-- == 0)
+            FAIL("Timed out");
+        std::array<char, 64> buf{};
+        out.append(buf.data(), uart.tx().read(buf));
+        for (auto eol = out.find('\n'); eol != std::string::npos; eol = out.find('\n')) {
+            lengths.push_back(std::stoul(out.substr(0, eol)));
+            out.erase(0, eol + 1);
+        }
+    }
+    REQUIRE(br.stop());
+    // Never short, and not dragging on either
+    for (const auto length : lengths) {
+        REQUIRE(length >= 2'000);
+        REQUIRE(length < 12'000);
+    }
+}
+
+TEST_CASE("Board resource usage", "[Board]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "noop", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board br{};
+    REQUIRE(br.configure({}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE_FALSE(br.resource_usage());
+    REQUIRE(br.start());
+    std::this_thread::sleep_for(200ms);
+
+    const auto usage = br.resource_usage();
+    REQUIRE(usage);
+    REQUIRE(usage->shm_size > 0);
+    REQUIRE(usage->shm_used > 0);
+    REQUIRE(usage->shm_used <= usage->shm_size);
+#ifdef __linux__
+    REQUIRE(usage->resident_memory > 0);
+    REQUIRE(usage->minor_faults > 0);
+    REQUIRE(usage->voluntary_context_switches > 0);
+#endif
+
+    const auto cached = br.resource_usage(1h);
+    REQUIRE(cached);
+    REQUIRE(cached->sampled_at == usage->sampled_at);
+    const auto fresh = br.resource_usage();
+    REQUIRE(fresh);
+    REQUIRE(fresh->sampled_at > usage->sampled_at);
+
+    REQUIRE(br.stop());
+    REQUIRE_FALSE(br.resource_usage());
+}
+
+TEST_CASE("Board scheduling", "[Board]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "noop", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+
+    using Policy = smce::BoardConfig::Scheduling::Policy;
+    smce::Board invalid{};
+    REQUIRE(invalid.configure({.scheduling = {.policy = Policy::fifo, .priority = 0}}));
+    REQUIRE(invalid.attach_sketch(sk));
+    REQUIRE_FALSE(invalid.start());
+    REQUIRE(invalid.status() != smce::Board::Status::running);
+
+#ifdef __linux__
+    using SpawnMethod = smce::BoardConfig::SpawnMethod;
+    for (const auto method : {SpawnMethod::fork, SpawnMethod::vfork}) {
+        smce::Board pinned{};
+        REQUIRE(pinned.configure({.scheduling = {.cpu_affinity = {0}, .nice = 5}, .spawn_method = method}));
+        REQUIRE(pinned.attach_sketch(sk));
+        REQUIRE(pinned.start());
+
+        // The sketch is the only child of this process
+        std::string cpus_allowed;
+        for (const auto& entry : smce::stdfs::directory_iterator{"/proc"}) {
+            std::ifstream status{entry.path() / "status"};
+            std::string allowed;
+            bool is_child = false;
+            for (std::string line; std::getline(status, line);) {
+                if (line.starts_with("PPid:"))
+                    is_child = std::stoi(line.substr(5)) == ::getpid();
+                else if (line.starts_with("Cpus_allowed_list:"))
+                    allowed = line.substr(line.find_first_not_of(" \t", 18));
+            }
+            if (is_child)
+                cpus_allowed = allowed;
+        }
+        REQUIRE(cpus_allowed == "0");
+        REQUIRE(pinned.stop());
+    }
+#endif
+}
+
+TEST_CASE("Board snapshot and restore", "[Board]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "noop", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+
+    const smce::BoardConfig bc{.pins = {0}, .gpio_drivers = {{0, {}, {{true, false}}}}, .uart_channels = {{}}};
+    smce::Board source{};
+    REQUIRE(source.configure(bc));
+    REQUIRE(source.attach_sketch(sk));
+    REQUIRE(source.prepare());
+    auto source_view = source.view();
+    source_view.pins[0].analog().write(42);
+    const std::array msg = {'S', 'T', 'A', 'T', 'E'};
+    REQUIRE(source_view.uart_channels[0].rx().write(msg) == msg.size());
+    std::vector<std::byte> image;
+    REQUIRE_FALSE(source.snapshot(image));
+    REQUIRE(image.size() < 64 * 1024);
+
+    smce::Board target{};
+    REQUIRE(target.configure(bc));
+    REQUIRE(target.attach_sketch(sk));
+    REQUIRE(target.restore(image) == smce::board_image_error::invalid_state);
+    REQUIRE(target.prepare());
+    REQUIRE(target.restore(std::span{image}.first(16)) == smce::board_image_error::malformed);
+    REQUIRE_FALSE(target.restore(image));
+    auto target_view = target.view();
+    REQUIRE(target_view.pins[0].analog().read() == 42);
+    std::array<char, msg.size()> in{};
+    REQUIRE(target_view.uart_channels[0].rx().read(in) == in.size());
+    REQUIRE(in == msg);
+
+    const auto image_path = smce::stdfs::path{SMCE_TEST_DIR} / "board.img";
+    REQUIRE_FALSE(source.snapshot(image_path));
+    REQUIRE_FALSE(target.restore(image_path));
+    REQUIRE(target_view.uart_channels[0].rx().size() == msg.size());
+
+    // Same layout, different configuration
+    smce::BoardConfig paced_bc = bc;
+    paced_bc.uart_channels[0].baud_rate = 300;
+    paced_bc.uart_channels[0].paced = true;
+    smce::Board paced{};
+    REQUIRE(paced.configure(paced_bc));
+    REQUIRE(paced.attach_sketch(sk));
+    REQUIRE(paced.prepare());
+    REQUIRE(paced.view().uart_channels[0].rx().write(msg) == msg.size());
+    REQUIRE(paced.view().uart_channels[0].rx().size() < msg.size());
+    REQUIRE_FALSE(paced.snapshot(image));
+    REQUIRE(target.restore(image) == smce::board_image_error::incompatible);
+    // Bytes which were still on the wire are not held back by the clock of the capturing board
+    REQUIRE_FALSE(paced.restore(image));
+    REQUIRE(paced.view().uart_channels[0].rx().size() == msg.size());
+
+    REQUIRE(target.start());
+    REQUIRE(target.restore(image) == smce::board_image_error::invalid_state);
+    REQUIRE(target.stop());
+}
+
+TEST_CASE("Board UART links", "[Board]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "uart", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+
+    // The host stands in for the sketch of the first board, the second one echoes back what it receives
+    smce::Board host_side{};
+    REQUIRE(host_side.configure({.uart_channels = {{}}}));
+    smce::Board echo{};
+    REQUIRE(echo.configure({.uart_channels = {{}}}));
+    REQUIRE(echo.attach_sketch(sk));
+    REQUIRE(host_side.link_uart(0, echo, 0) == std::errc::operation_not_permitted);
+    REQUIRE(host_side.prepare());
+    REQUIRE(echo.prepare());
+    REQUIRE(host_side.link_uart(1, echo, 0) == std::errc::invalid_argument);
+    REQUIRE(host_side.link_uart(0, host_side, 0) == std::errc::invalid_argument);
+    REQUIRE_FALSE(host_side.link_uart(0, echo, 0));
+    REQUIRE(echo.link_uart(0, host_side, 0) == std::errc::invalid_argument);
+    REQUIRE(echo.start());
+
+    auto uart = host_side.view().uart_channels[0];
+    const std::array msg = {'L', 'I', 'N', 'K'};
+    REQUIRE(uart.rx().write(msg) == 0);
+    REQUIRE(uart.tx().write(msg) == msg.size());
+    int ticks = 16'000;
+    while (uart.rx().size() != msg.size()) {
+        if (ticks-- == 0)
+            FAIL("Timed out");
+        std::this_thread::sleep_for(1ms);
+    }
+    REQUIRE(uart.rx().front() == 'L');
+    std::array<char, msg.size()> in{};
+    REQUIRE(uart.rx().read(in) == in.size());
+    REQUIRE(in == msg);
+    REQUIRE(echo.view().uart_channels[0].tx().size() == 0);
+
+    // Tearing either end down disconnects the other one as well
+    REQUIRE(host_side.reset());
+    auto echo_uart = echo.view().uart_channels[0];
+    REQUIRE(echo_uart.rx().write(msg) == msg.size());
+    ticks = 16'000;
+    while (echo_uart.tx().size() != msg.size()) {
+        if (ticks-- == 0)
+            FAIL("Timed out");
+        std::this_thread::sleep_for(1ms);
+    }
+    REQUIRE(echo_uart.tx().read(in) == in.size());
+    REQUIRE(in == msg);
+    REQUIRE(echo.stop());
+
+    // Links keep to the pace of their paced end, whichever end transmits
+    smce::Board slow{};
+    REQUIRE(slow.configure({.uart_channels = {{.baud_rate = 300, .paced = true}, {.paced = true}}}));
+    REQUIRE(slow.prepare());
+    REQUIRE(host_side.configure({.uart_channels = {{}}}));
+    REQUIRE(host_side.prepare());
+    REQUIRE(slow.link_uart(0, slow, 1) == std::errc::invalid_argument);
+    REQUIRE_FALSE(host_side.link_uart(0, slow, 0));
+    REQUIRE(host_side.view().uart_channels[0].tx().write(msg) == msg.size());
+    REQUIRE(slow.view().uart_channels[0].rx().size() < msg.size());
+
+    // Bytes still on the wire go down with the link
+    REQUIRE(host_side.reset());
+    auto slow_rx = slow.view().uart_channels[0].rx();
+    REQUIRE(slow_rx.size() == 0);
+    REQUIRE(slow_rx.write(msg) == msg.size());
+}
+
+#ifdef __linux__
+TEST_CASE("Board events", "[Board]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "uart", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+
+    // Waits on the descriptor until an event of interest is taken
+    const auto wait_for = [](smce::Board& br, bool smce::Board::Events::*source) {
+        for (int i = 0; i < 100; ++i) {
+            pollfd pfd{.fd = br.event_fd(), .events = POLLIN, .revents = 0};
+            if (::poll(&pfd, 1, 100) == 1 && br.take_events().*source)
+                return true;
+        }
+        return false;
+    };
+
+    using SpawnMethod = smce::BoardConfig::SpawnMethod;
+    for (const auto method : {SpawnMethod::fork, SpawnMethod::vfork}) {
+        smce::Board br{};
+        REQUIRE(br.event_fd() == -1);
+        REQUIRE(br.configure({.uart_channels = {{}}, .spawn_method = method}));
+        REQUIRE(br.attach_sketch(sk));
+        REQUIRE(br.prepare());
+        REQUIRE(br.event_fd() != -1);
+
+        // Writes of the host itself raise nothing
+        auto uart = br.view().uart_channels[0];
+        const std::array msg = {'E', 'V'};
+        REQUIRE(uart.rx().write(msg) == msg.size());
+        pollfd pfd{.fd = br.event_fd(), .events = POLLIN, .revents = 0};
+        REQUIRE(::poll(&pfd, 1, 0) == 0);
+
+        REQUIRE(br.start());
+        REQUIRE(wait_for(br, &smce::Board::Events::uart_tx));
+        std::array<char, msg.size()> echo{};
+        REQUIRE(uart.tx().read(echo) == echo.size());
+        REQUIRE(echo == msg);
+        REQUIRE(br.terminate());
+        REQUIRE(wait_for(br, &smce::Board::Events::exited));
+        REQUIRE(::poll(&pfd, 1, 0) == 0);
+    }
+}
+#endif
+
 #ifdef SMCE_TEST_JUNIPER
 
 TEST_CASE("Juniper sources", "[Board]") {
@@ -18,6 +18,11 @@
 
 #include <chrono>
 #include <iostream>
+#include <string_view>
+#include <vector>
+#ifdef __linux__
+#    include <poll.h>
+#endif
 #include <catch2/catch_test_macros.hpp>
 #include "SMCE/Board.hpp"
 #include "SMCE/BoardConf.hpp"
@@ -57,11 +62,17 @@ TEST_CASE("Basic board device", "[BoardDevice]") {
 
     REQUIRE(br.configure(std::move(bc)));
     REQUIRE(br.attach_sketch(sk));
-    REQUIRE(br.start());
+    REQUIRE(br.prepare());
     auto bv = br.view();
     REQUIRE(bv.valid());
+    auto changes = bv.changes_since(0);
+    // Handing fields out and reading them changes nothing
     auto devs = TestUDD::getObjects(bv);
     REQUIRE(devs.size() == 2);
+    REQUIRE(devs[0].f2.load() == 0);
+    changes = bv.changes_since(changes.generation);
+    REQUIRE(changes.devices.empty());
+    REQUIRE(br.start());
     {
         std::size_t ticks = 8192;
         do {
@@ -84,6 +95,16 @@ TEST_CASE("Basic board device", "[BoardDevice]") {
         REQUIRE(devs[1].f2.load() == 65500);
         REQUIRE(devs[0].f2.load() != 65500);
     }
+    // Stores of the sketch do
+    changes = bv.changes_since(changes.generation);
+    REQUIRE(changes.devices == std::vector<std::string_view>{"TestUDD"});
+    REQUIRE(bv.changes_since(changes.generation).devices.empty());
+    // and wake the host up
+#ifdef __linux__
+    pollfd pfd{.fd = br.event_fd(), .events = POLLIN, .revents = 0};
+    REQUIRE(::poll(&pfd, 1, 1000) == 1);
+#endif
+    REQUIRE(br.take_events().devices);
     // FIXME test mutexes and constant storage
     REQUIRE(br.stop());
 }
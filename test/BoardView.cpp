@@ -16,15 +16,24 @@
  *
  */
 
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <numeric>
+#include <string>
 #include <thread>
 #include <catch2/catch_test_macros.hpp>
 #include "SMCE/Board.hpp"
 #include "SMCE/BoardConf.hpp"
 #include "SMCE/BoardView.hpp"
+#include "SMCE/Coroutines.hpp"
+#include "SMCE/InputRecording.hpp"
+#include "SMCE/Netlist.hpp"
 #include "SMCE/Toolchain.hpp"
+#include "SMCE/TraceExport.hpp"
 #include "defs.hpp"
 
 using namespace std::literals;
@@ -91,6 +100,320 @@ TEST_CASE("BoardView GPIO", "[BoardView]") {
     REQUIRE(br.stop());
 }
 
+TEST_CASE("BoardView netlist", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "pins", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+
+    // Both boards invert pin 0 onto pin 2; chaining them makes for a buffer
+    const smce::BoardConfig bc{.pins = {0, 2}, .gpio_drivers = {{0, {{true, false}}, {}}, {2, {{false, true}}, {}}}};
+    smce::Board first{};
+    smce::Board second{};
+    for (auto* br : {&first, &second}) {
+        REQUIRE(br->configure(bc));
+        REQUIRE(br->attach_sketch(sk));
+        REQUIRE(br->prepare());
+    }
+
+    using Endpoint = smce::Netlist::Endpoint;
+    smce::Netlist netlist;
+    const std::array net{Endpoint{first.view(), 2}, Endpoint{second.view(), 0}};
+    REQUIRE(netlist.connect(std::span{net}.first(1)) == std::errc::invalid_argument);
+    REQUIRE(netlist.connect(std::array{Endpoint{first.view(), 2}, Endpoint{first.view(), 1}}) ==
+            std::errc::invalid_argument);
+    REQUIRE_FALSE(netlist.connect(net));
+    REQUIRE(netlist.connect(net) == std::errc::invalid_argument);
+    REQUIRE(netlist.size() == 1);
+    smce::Netlist other;
+    REQUIRE(other.connect(std::array{Endpoint{first.view(), 0}, Endpoint{second.view(), 2}}) ==
+            std::errc::device_or_resource_busy);
+
+    REQUIRE(first.start());
+    REQUIRE(second.start());
+    REQUIRE_FALSE(netlist.start(std::chrono::microseconds{50}));
+    auto input = first.view().pins[0].digital();
+    auto output = second.view().pins[2].digital();
+    input.write(true);
+    test_pin_delayable(output, true, 16384, 1ms);
+    input.write(false);
+    test_pin_delayable(output, false, 16384, 1ms);
+    netlist.clear();
+    REQUIRE(netlist.size() == 0);
+    REQUIRE(first.stop());
+    REQUIRE(second.stop());
+}
+
+TEST_CASE("BoardView changes", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "noop", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board br{};
+    REQUIRE(br.configure({.pins = {0, 2}, .gpio_drivers = {{0, {{true, true}}, {}}, {2, {{true, true}}, {}}},
+                          .uart_channels = {{}}}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.prepare());
+    auto bv = br.view();
+
+    auto changes = bv.changes_since(0);
+    REQUIRE(changes.empty());
+    changes = bv.changes_since(changes.generation);
+    REQUIRE(changes.empty());
+
+    bv.pins[2].digital().write(true);
+    changes = bv.changes_since(changes.generation);
+    REQUIRE(changes.pins == std::vector<std::size_t>{2});
+    REQUIRE(changes.uart_channels.empty());
+    changes = bv.changes_since(changes.generation);
+    REQUIRE(changes.empty());
+
+    const std::array data{'a', 'b'};
+    REQUIRE(bv.uart_channels[0].rx().write(data) == data.size());
+    bv.pins[0].digital().write(true);
+    changes = bv.changes_since(changes.generation);
+    REQUIRE(changes.pins == std::vector<std::size_t>{0});
+    REQUIRE(changes.uart_channels == std::vector<std::size_t>{0});
+    REQUIRE(bv.changes_since(changes.generation).empty());
+    REQUIRE(bv.changes_since(0).pins.size() == 2);
+}
+
+static smce::Task toggle_scenario(smce::BoardView bv, int& edges) {
+    auto input = bv.pins[0].digital();
+    while (!bv.pins[2].digital().read())
+        co_await smce::async_sleep(1ms);
+    for (const bool level : {true, false, true}) {
+        // The level gets sampled when the awaiter is made, so it has to come before the write
+        auto edge = smce::async_wait_edge(bv.pins[2]);
+        input.write(level);
+        REQUIRE(co_await edge == !level);
+        ++edges;
+    }
+}
+
+static smce::Task expect_echo(smce::VirtualUart uart, std::string_view msg) {
+    REQUIRE(uart.rx().write(msg) == msg.size());
+    std::string echo;
+    while (echo.size() < msg.size()) {
+        std::array<char, 16> buf{};
+        const auto count = co_await smce::async_read(uart.tx(), buf);
+        echo.append(buf.data(), count);
+    }
+    REQUIRE(echo == msg);
+}
+
+static smce::Task echo_scenario(smce::Board& br, int& echoes) {
+    for (const auto msg : {"Hello"sv, "World"sv}) {
+        co_await expect_echo(br.view().uart_channels[0], msg);
+        ++echoes;
+    }
+    REQUIRE(br.terminate());
+    REQUIRE(co_await smce::async_exit(br) == smce::Board::Status::stopped);
+}
+
+static smce::Task sleeper(std::chrono::milliseconds duration, int& woken) {
+    co_await smce::async_sleep(duration);
+    ++woken;
+}
+
+TEST_CASE("BoardView coroutines", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch pins_sk{SKETCHES_PATH "pins", {.fqbn = "arduino:avr:nano"}};
+    smce::Sketch uart_sk{SKETCHES_PATH "uart", {.fqbn = "arduino:avr:nano"}};
+    for (auto* sk : {&pins_sk, &uart_sk}) {
+        const auto ec = tc.compile(*sk);
+        if (ec)
+            std::cerr << tc.build_log().second;
+        REQUIRE_FALSE(ec);
+    }
+
+    smce::Board pins_br{};
+    REQUIRE(pins_br.configure({.pins = {0, 2}, .gpio_drivers = {{0, {{true, false}}, {}}, {2, {{false, true}}, {}}}}));
+    REQUIRE(pins_br.attach_sketch(pins_sk));
+    smce::Board uart_br{};
+    REQUIRE(uart_br.configure({.uart_channels = {{}}}));
+    REQUIRE(uart_br.attach_sketch(uart_sk));
+    REQUIRE(pins_br.start());
+    REQUIRE(uart_br.start());
+
+    smce::Scheduler sched;
+    sched.watch(pins_br);
+    sched.watch(uart_br);
+    int edges = 0;
+    int echoes = 0;
+    int woken = 0;
+    sched.spawn(toggle_scenario(pins_br.view(), edges));
+    sched.spawn(echo_scenario(uart_br, echoes));
+    constexpr int sleepers = 1000;
+    for (int i = 0; i < sleepers; ++i)
+        sched.spawn(sleeper(std::chrono::milliseconds{i % 10}, woken));
+    REQUIRE(sched.size() == sleepers + 2);
+    sched.run();
+    REQUIRE(sched.size() == 0);
+    REQUIRE(edges == 3);
+    REQUIRE(echoes == 2);
+    REQUIRE(woken == sleepers);
+    REQUIRE(pins_br.stop());
+}
+
+TEST_CASE("BoardView diagnostics", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "pins", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board br{};
+    // Pin 2 is missing, so that every loop misuses it
+    REQUIRE(br.configure({.pins = {0}, .gpio_drivers = {{0, {{true, false}}, {}}}}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.start());
+    auto bv = br.view();
+    REQUIRE(bv.valid());
+    REQUIRE(bv.diagnostics.exists());
+
+    const auto digital_write_count = [&] {
+        for (const auto& entry : bv.diagnostics.entries()) {
+            if (entry.site == "digitalWrite" && entry.message == "Pin does not exist")
+                return entry.count;
+        }
+        return std::uint64_t{0};
+    };
+    int ticks = 0;
+    while (ticks++ < 5000 && digital_write_count() < 16)
+        std::this_thread::sleep_for(1ms);
+    REQUIRE(digital_write_count() >= 16);
+    REQUIRE(bv.diagnostics.entries().size() == 2); // pinMode & digitalWrite
+    REQUIRE(bv.diagnostics.dropped() == 0);
+
+    // Only the first occurrence is due within the interval
+    REQUIRE(bv.diagnostics.report("host", "test", 1h) == 1);
+    REQUIRE(bv.diagnostics.report("host", "test", 1h) == 0);
+    REQUIRE(bv.diagnostics.report("host", "test", 0s) == 3);
+
+    // Misuses which do not fit in the table anymore still get logged, though not counted
+    for (int i = 0; bv.diagnostics.entries().size() < 64; ++i)
+        REQUIRE(bv.diagnostics.report("host", "fill " + std::to_string(i), 1h) == 1);
+    REQUIRE(bv.diagnostics.report("host", "overflow", 1h) == 1);
+    REQUIRE(bv.diagnostics.report("host", "overflow", 1h) == 0);
+    REQUIRE(bv.diagnostics.dropped() == 2);
+    REQUIRE(br.stop());
+}
+
+TEST_CASE("BoardView loop stats", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "noop", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board br{};
+    REQUIRE(br.configure({}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.start());
+    auto bv = br.view();
+    REQUIRE(bv.valid());
+
+    int ticks = 0;
+    while (ticks++ < 5000 && bv.loop_stats().iterations < 64)
+        std::this_thread::sleep_for(1ms);
+    const auto stats = bv.loop_stats();
+    REQUIRE(stats.setup_duration);
+    REQUIRE(stats.iterations >= 64);
+    REQUIRE(std::accumulate(stats.histogram.begin(), stats.histogram.end(), std::uint64_t{0}) >= stats.iterations);
+    // Each iteration of noop sleeps for 1ms
+    REQUIRE(stats.mean_duration() >= 1ms);
+    REQUIRE(stats.percentile(0.5) >= 1ms);
+    REQUIRE(stats.percentile(0.5) <= stats.max_duration);
+    REQUIRE(stats.percentile(1.0) <= stats.max_duration);
+    REQUIRE(br.stop());
+}
+
+TEST_CASE("BoardView API call stats listing", "[BoardView]") {
+    REQUIRE(smce::BoardView{}.api_call_stats().empty());
+
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "pins", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board br{};
+    REQUIRE(br.configure({.pins = {0, 2}, .gpio_drivers = {{0, {{true, false}}, {}}, {2, {{false, true}}, {}}}}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.start());
+    auto bv = br.view();
+    int ticks = 0;
+    while (ticks++ < 5000 && !bv.pins[2].digital().read())
+        std::this_thread::sleep_for(1ms);
+    REQUIRE(bv.pins[2].digital().read());
+
+    // Every entry point is listed once, whether or not Ardrivo counts its calls
+    const auto stats = bv.api_call_stats();
+    REQUIRE_FALSE(stats.empty());
+    for (const auto& entry : stats) {
+        REQUIRE_FALSE(entry.api.empty());
+        REQUIRE(std::count_if(stats.begin(), stats.end(), [&](const auto& e) { return e.api == entry.api; }) == 1);
+#if !SMCE_ARDRIVO_API_COUNTERS
+        REQUIRE(entry.calls == 0);
+        REQUIRE(entry.failures == 0);
+        REQUIRE(entry.total_duration.count() == 0);
+#endif
+    }
+    REQUIRE(br.stop());
+}
+
+#if SMCE_ARDRIVO_API_COUNTERS
+
+TEST_CASE("BoardView API call stats", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "pins", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board br{};
+    // Pin 2 is missing, so that every digitalWrite fails
+    REQUIRE(br.configure({.pins = {0}, .gpio_drivers = {{0, {{true, false}}, {}}}}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.start());
+    auto bv = br.view();
+    REQUIRE(bv.valid());
+
+    const auto stats_of = [&](std::string_view api) {
+        for (const auto& stats : bv.api_call_stats()) {
+            if (stats.api == api)
+                return stats;
+        }
+        return smce::ApiCallStats{};
+    };
+    int ticks = 0;
+    while (ticks++ < 5000 && stats_of("digitalWrite").calls < 16)
+        std::this_thread::sleep_for(1ms);
+    const auto reads = stats_of("digitalRead");
+    const auto writes = stats_of("digitalWrite");
+    REQUIRE(reads.calls >= 16);
+    REQUIRE(reads.failures == 0);
+    REQUIRE(writes.calls >= 16);
+    REQUIRE(writes.failures == writes.calls);
+    REQUIRE(writes.total_duration.count() > 0);
+    REQUIRE(stats_of("analogRead").calls == 0);
+    REQUIRE(br.stop());
+}
+
+#endif
+
 TEST_CASE("BoardView UART", "[BoardView]") {
     smce::Toolchain tc{SMCE_PATH};
     REQUIRE(!tc.check_suitable_environment());
@@ -147,6 +470,298 @@ TEST_CASE("BoardView UART", "[BoardView]") {
     REQUIRE(br.stop());
 }
 
+TEST_CASE("BoardView UART in place", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "uart", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board br{};
+    REQUIRE(br.configure({.uart_channels = {{.rx_buffer_length = 8, .tx_buffer_length = 8}}}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.prepare());
+    auto rx = br.view().uart_channels[0].rx();
+
+    // Move the indices along so that the next bytes wrap around the end of the storage
+    const std::array<char, 6> filler{};
+    std::array<char, 6> sink{};
+    REQUIRE(rx.write(filler) == filler.size());
+    REQUIRE(rx.read(sink) == sink.size());
+
+    auto spans = rx.prepare(16);
+    REQUIRE(spans[0].size() == 2);
+    REQUIRE(spans[1].size() == 6);
+    const std::string_view msg = "Hello";
+    std::copy_n(msg.begin(), spans[0].size(), spans[0].begin());
+    std::copy(msg.begin() + spans[0].size(), msg.end(), spans[1].begin());
+    REQUIRE(rx.size() == 0);
+    rx.commit(msg.size());
+    REQUIRE(rx.size() == msg.size());
+
+    const auto held = rx.peek();
+    REQUIRE(std::string{held[0].begin(), held[0].end()} + std::string{held[1].begin(), held[1].end()} == msg);
+    REQUIRE(rx.front() == 'H');
+
+    // The sketch echoes what it receives, which the host decodes in place
+    REQUIRE(br.start());
+    auto tx = br.view().uart_channels[0].tx();
+    std::string echo;
+    for (int ticks = 16'384; echo.size() < msg.size(); std::this_thread::sleep_for(1ms)) {
+        if (ticks-- == 0)
+            FAIL("Timed out");
+        const auto bytes = tx.peek();
+        for (const auto piece : bytes)
+            echo.append(piece.begin(), piece.end());
+        tx.consume(bytes[0].size() + bytes[1].size());
+    }
+    REQUIRE(echo == msg);
+    REQUIRE(tx.size() == 0);
+    REQUIRE(rx.size() == 0);
+    REQUIRE(br.stop());
+}
+
+TEST_CASE("BoardView UART pacing", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "uart", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board br{};
+    // 10 bits per byte at 1000 baud take 10ms each
+    REQUIRE(br.configure({.uart_channels = {{.baud_rate = 1000, .paced = true}}}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.prepare());
+    auto rx = br.view().uart_channels[0].rx();
+    auto tx = br.view().uart_channels[0].tx();
+
+    const std::string_view msg = "Hello, World";
+    const auto sent = std::chrono::steady_clock::now();
+    REQUIRE(rx.write(msg) == msg.size());
+    REQUIRE(rx.size() < msg.size());
+    for (int ticks = 16'384; rx.size() < msg.size(); std::this_thread::sleep_for(1ms)) {
+        if (ticks-- == 0)
+            FAIL("Timed out");
+    }
+    REQUIRE(std::chrono::steady_clock::now() - sent >= 110ms);
+
+    // The echo of the sketch gets held back on the way out just the same
+    REQUIRE(br.start());
+    std::string echo;
+    std::size_t largest_step = 0;
+    for (int ticks = 16'384; echo.size() < msg.size(); std::this_thread::sleep_for(1ms)) {
+        if (ticks-- == 0)
+            FAIL("Timed out");
+        std::array<char, 64> buf{};
+        const auto count = tx.read(buf);
+        largest_step = std::max(largest_step, count);
+        echo.append(buf.data(), count);
+    }
+    REQUIRE(echo == msg);
+    REQUIRE(largest_step < msg.size());
+    REQUIRE(br.stop());
+}
+
+TEST_CASE("BoardView UART coalescing", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "coalescing", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+
+    // Hands the board a message, and returns once the board echoed it while still keeping busy
+    const auto send = [](smce::VirtualUart uart, std::string_view msg) {
+        REQUIRE(uart.rx().write(msg) == msg.size());
+        for (int ticks = 16'384; uart.rx().size() != 0; std::this_thread::sleep_for(1ms)) {
+            if (ticks-- == 0)
+                FAIL("Timed out");
+        }
+        std::this_thread::sleep_for(50ms);
+    };
+    const auto receive = [](smce::VirtualUart uart, std::size_t size) {
+        std::string echo;
+        for (int ticks = 16'384; echo.size() < size; std::this_thread::sleep_for(1ms)) {
+            if (ticks-- == 0)
+                FAIL("Timed out");
+            std::array<char, 64> buf{};
+            echo.append(buf.data(), uart.tx().read(buf));
+        }
+        return echo;
+    };
+
+    smce::Board br{};
+    REQUIRE(br.configure({.uart_channels = {{.flushing_threshold = 8}}}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.start());
+    auto uart0 = br.view().uart_channels[0];
+
+    // Short of the threshold, nothing goes out until the iteration ends past the timeout
+    send(uart0, "Hello");
+    REQUIRE(uart0.tx().size() == 0);
+    REQUIRE(receive(uart0, 5) == "Hello");
+
+    // Full batches go out right away, the rest waits
+    send(uart0, "Hello, World");
+    REQUIRE(uart0.tx().size() == 8);
+    REQUIRE(receive(uart0, 12) == "Hello, World");
+    REQUIRE(br.stop());
+
+    // Ends of lines flush whatever precedes them, but nothing past them
+    smce::Board lines{};
+    REQUIRE(lines.configure({.uart_channels = {{.flushing_threshold = 64, .flush_on_newline = true}}}));
+    REQUIRE(lines.attach_sketch(sk));
+    REQUIRE(lines.start());
+    auto uart1 = lines.view().uart_channels[0];
+    send(uart1, "Hi\nthere");
+    REQUIRE(uart1.tx().size() == 3);
+    REQUIRE(receive(uart1, 8) == "Hi\nthere");
+    REQUIRE(lines.stop());
+
+    // Thresholds past the tx buffer are capped to it, rather than wrapped around to no coalescing at all
+    smce::Board capped{};
+    REQUIRE(capped.configure({.uart_channels = {{.flushing_threshold = 65'536}}}));
+    REQUIRE(capped.attach_sketch(sk));
+    REQUIRE(capped.start());
+    auto uart2 = capped.view().uart_channels[0];
+    send(uart2, "Hello");
+    REQUIRE(uart2.tx().size() == 0);
+    REQUIRE(receive(uart2, 5) == "Hello");
+    REQUIRE(capped.stop());
+}
+
+TEST_CASE("BoardView tracing", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "uart", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    smce::Board br{};
+    // Pace the loop so that its events do not wrap the board ring before the UART ones get read out
+    REQUIRE(br.configure({.uart_channels = {{}},
+                          .loop_pacing = {.policy = smce::BoardConfig::LoopPacing::Policy::fixed_rate, .rate = 1000},
+                          .tracing = true}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.start());
+    auto bv = br.view();
+    REQUIRE(bv.valid());
+    REQUIRE(bv.tracing.enabled());
+
+    using Source = smce::Tracing::Source;
+    using Phase = smce::Tracing::Phase;
+    auto uart0 = bv.uart_channels[0];
+    std::array out = {'T', 'R', 'A', 'C', 'E'};
+    REQUIRE(uart0.rx().write(out) == out.size());
+    int ticks = 16'000;
+    while (uart0.tx().size() != out.size()) {
+        if (ticks-- == 0)
+            FAIL("Timed out");
+        std::this_thread::sleep_for(1ms);
+    }
+    bv.tracing.record(Source::host, Phase::instant, "check \"quoted\"", 42);
+    bv.tracing.set_enabled(false);
+
+    const auto events = bv.tracing.events();
+    REQUIRE(std::is_sorted(events.begin(), events.end(),
+                           [](const auto& lhs, const auto& rhs) { return lhs.timestamp < rhs.timestamp; }));
+    const auto has_event = [&](Source source, Phase phase, std::string_view name) {
+        return std::any_of(events.begin(), events.end(), [&](const auto& event) {
+            return event.source == source && event.phase == phase && event.name == name;
+        });
+    };
+    REQUIRE(has_event(Source::board, Phase::begin, "loop"));
+    REQUIRE(has_event(Source::board, Phase::end, "loop"));
+    REQUIRE(has_event(Source::host, Phase::end, "uart.write"));
+    REQUIRE(has_event(Source::board, Phase::end, "uart.read"));
+    REQUIRE(has_event(Source::host, Phase::instant, "check \"quoted\""));
+
+    const auto trace_path = smce::stdfs::path{SMCE_TEST_DIR} / "traces" / "uart.json";
+    REQUIRE_FALSE(smce::export_chrome_trace(events, trace_path));
+    std::ifstream trace_file{trace_path};
+    const std::string trace{std::istreambuf_iterator<char>{trace_file}, {}};
+    REQUIRE(trace.starts_with("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    REQUIRE(trace.find("\"name\":\"check \\\"quoted\\\"\"") != std::string::npos);
+    REQUIRE(br.stop());
+
+    // Boards without tracing configured have no rings to record into
+    smce::Board untraced{};
+    REQUIRE(untraced.configure({.uart_channels = {{}}}));
+    REQUIRE(untraced.attach_sketch(sk));
+    REQUIRE(untraced.prepare());
+    auto untraced_view = untraced.view();
+    untraced_view.tracing.set_enabled(true);
+    REQUIRE_FALSE(untraced_view.tracing.enabled());
+    untraced_view.tracing.record(Source::host, Phase::instant, "dropped");
+    REQUIRE(untraced_view.tracing.events().empty());
+}
+
+TEST_CASE("BoardView input recording", "[BoardView]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    smce::Sketch sk{SKETCHES_PATH "noop", {.fqbn = "arduino:avr:nano"}};
+    const auto ec = tc.compile(sk);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+
+    const smce::BoardConfig bc{.pins = {0, 1}, .gpio_drivers = {{0, {}, {{true, true}}}}, .uart_channels = {{}}};
+    smce::Board source{};
+    REQUIRE(source.configure(bc));
+    REQUIRE(source.attach_sketch(sk));
+    REQUIRE(source.prepare());
+    auto source_view = source.view();
+    const auto recording_path = smce::stdfs::path{SMCE_TEST_DIR} / "recordings" / "inputs.rec";
+    smce::InputRecorder recorder;
+    REQUIRE_FALSE(recorder.start(source_view, recording_path));
+    REQUIRE(recorder.recording());
+    smce::InputRecorder other_recorder;
+    REQUIRE(other_recorder.start(source_view, recording_path) == std::errc::device_or_resource_busy);
+
+    source_view.pins[0].analog().write(42);
+    std::this_thread::sleep_for(20ms);
+    const std::array msg = {'R', 'E', 'P', 'L', 'A', 'Y', '!', '!'};
+    REQUIRE(source_view.uart_channels[0].rx().write(std::span{msg}.first(6)) == 6);
+    // Bytes committed in place are recorded too
+    const auto spans = source_view.uart_channels[0].rx().prepare(2);
+    REQUIRE(spans[0].size() + spans[1].size() == 2);
+    for (auto piece : spans)
+        std::fill(piece.begin(), piece.end(), '!');
+    source_view.uart_channels[0].rx().commit(2);
+    // Enough events to fill several chunks, which get handed over to the recorder's worker
+    for (int i = 0; i < 50'000; ++i)
+        source_view.pins[0].analog().write(i % 128);
+    source_view.pins[0].digital().write(true);
+    REQUIRE_FALSE(recorder.stop());
+    REQUIRE_FALSE(recorder.recording());
+
+    smce::Board target{};
+    REQUIRE(target.configure(bc));
+    REQUIRE(target.attach_sketch(sk));
+    REQUIRE(target.prepare());
+    auto target_view = target.view();
+    REQUIRE(smce::InputRecorder::replay(target_view, smce::stdfs::path{SMCE_TEST_DIR} / "missing.rec"));
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(smce::InputRecorder::replay(target_view, recording_path));
+    REQUIRE(std::chrono::steady_clock::now() - start >= 20ms);
+    REQUIRE(target_view.pins[0].analog().read() == 255);
+    std::array<char, msg.size()> in{};
+    REQUIRE(target_view.uart_channels[0].rx().read(in) == in.size());
+    REQUIRE(in == msg);
+
+    // Back-to-back replay of a recording whose last chunk got cut short
+    const auto size = smce::stdfs::file_size(recording_path);
+    smce::stdfs::resize_file(recording_path, size - 1);
+    target_view.pins[0].analog().write(0);
+    REQUIRE_FALSE(smce::InputRecorder::replay(target_view, recording_path, 0));
+    REQUIRE(target_view.pins[0].analog().read() != 255);
+}
+
 TEST_CASE("UART strconv", "[BoardView]") {
     smce::Toolchain tc{SMCE_PATH};
     REQUIRE(!tc.check_suitable_environment());
@@ -69,7 +69,8 @@ TEST_CASE("Invalid manifests processing", "[Plugin]") {
     const std::filesystem::path tmproot = SMCE_PATH "/tmp";
 
     std::string manifest =
-        GENERATE("BadName", "BadUriLocation", "BadUriScheme", "NoName", "NoUri", "NoVersion", "RelativeUri");
+        GENERATE("BadName", "BadUriLocation", "BadUriScheme", "CircularDepends", "NoName", "NoUri", "NoVersion",
+                 "RelativeUri", "UnknownDepends");
     INFO("Using manifest " + manifest);
 
     const auto base_dir = tmproot / ("test-" + manifest);
@@ -166,6 +167,49 @@ TEST_CASE("Valid manifests processing", "[Plugin]") {
                                     (bp::std_out & bp::std_err) > stderr);
         REQUIRE(res == 0);
     }
+
+    SECTION("LocalDependencies") {
+        // Declared in reverse dependency order; the patched plugin goes through concurrent preparation
+        smce::PluginManifest dependent{.name = "Dependent",
+                                       .version = "0",
+                                       .depends = {"Dependency"},
+                                       .uri = "file://" PATCHES_PATH "ESP32_analogRewrite",
+                                       .defaults = smce::PluginManifest::Defaults::arduino};
+        std::filesystem::create_directory(plugin_root);
+        smce::PluginManifest dependency{.name = "Dependency",
+                                        .version = "0",
+                                        .uri = "file://" + plugin_root.generic_string(),
+                                        .patch_uri = "file://" PATCHES_PATH "ESP32_analogRewrite",
+                                        .defaults = smce::PluginManifest::Defaults::none};
+        write_manifest(dependent, base_dir / "manifests" / "A.cmake");
+        write_manifest(dependency, base_dir / "manifests" / "B.cmake");
+
+        {
+            std::ofstream empty_source{base_dir / "empty.cxx"};
+            empty_source << "# empty\n";
+            std::ofstream loader{base_dir / "CMakeLists.txt"};
+            loader << "cmake_minimum_required (VERSION 3.12)\n";
+            loader << "list (APPEND CMAKE_MODULE_PATH \"" << module_path << "\")\n";
+            loader << "project (Test)\n";
+            loader << "add_library (Ardrivo INTERFACE)\n";
+            loader << "add_executable (Sketch empty.cxx)\n";
+            loader << "include (ProcessManifests)\n";
+            loader << "if (NOT TARGET smce_plugin_Dependent OR NOT TARGET smce_plugin_Dependency)\n";
+            loader << "  message (FATAL_ERROR \"ASSERTION FAILURE\")\n";
+            loader << "endif ()\n";
+            loader << "if (NOT SMCE_PLUGIN_ORDER STREQUAL \"Dependency;Dependent\")\n";
+            loader << "  message (FATAL_ERROR \"ASSERTION FAILURE: order is ${SMCE_PLUGIN_ORDER}\")\n";
+            loader << "endif ()\n";
+        }
+
+        const auto res = bp::system(bp::shell, bp::start_dir(base_dir.generic_string()),
+#if !BOOST_OS_WINDOWS
+                                    bp::env["CMAKE_GENERATOR"] = generator,
+#endif
+                                    "cmake", "--log-level=DEBUG", "-DSMCE_DIR=" SMCE_PATH, "-S", ".", "-B", "build",
+                                    (bp::std_out & bp::std_err) > stderr);
+        REQUIRE(res == 0);
+    }
 }
 
 TEST_CASE("Valid download caching", "[Plugin]") {
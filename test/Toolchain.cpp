@@ -15,11 +15,21 @@
  *  limitations under the License.
  *
  */
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <catch2/catch_test_macros.hpp>
+#include "SMCE/Board.hpp"
+#include "SMCE/Sketch.hpp"
 #include "SMCE/Toolchain.hpp"
 #include "defs.hpp"
 
+using namespace std::literals;
+
 TEST_CASE("Toolchain invalid", "[Toolchain]") {
     const auto path = SMCE_TEST_DIR "/empty_dir";
     std::filesystem::create_directory(path);
@@ -34,3 +44,105 @@ TEST_CASE("Toolchain valid", "[Toolchain]") {
     REQUIRE(tc.resource_dir() == SMCE_PATH);
     REQUIRE_FALSE(tc.cmake_path().empty());
 }
+
+TEST_CASE("Toolchain fingerprint", "[Toolchain]") {
+    const auto fingerprint = std::filesystem::path{SMCE_PATH} / "toolchain.fingerprint";
+    [[maybe_unused]] std::error_code ec;
+    std::filesystem::remove(fingerprint, ec);
+
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+    REQUIRE(std::filesystem::exists(fingerprint));
+
+    smce::Toolchain cached_tc{SMCE_PATH};
+    REQUIRE(!cached_tc.check_suitable_environment());
+    REQUIRE(cached_tc.cmake_path() == tc.cmake_path());
+
+    // A fingerprint matching in everything but the mtime of cmake gets refreshed
+    std::vector<std::string> lines;
+    {
+        std::ifstream fresh{fingerprint};
+        for (std::string line; std::getline(fresh, line);)
+            lines.push_back(line.starts_with("cmake_mtime=") ? "cmake_mtime=0" : line);
+    }
+    REQUIRE(std::count(lines.begin(), lines.end(), "cmake_mtime=0") == 1);
+    {
+        std::ofstream stale{fingerprint};
+        for (const auto& line : lines)
+            stale << line << '\n';
+    }
+    smce::Toolchain reprobed_tc{SMCE_PATH};
+    REQUIRE(!reprobed_tc.check_suitable_environment());
+    REQUIRE(reprobed_tc.cmake_path() == tc.cmake_path());
+    std::ifstream refreshed{fingerprint};
+    std::vector<std::string> refreshed_lines;
+    for (std::string line; std::getline(refreshed, line);)
+        refreshed_lines.push_back(line);
+    REQUIRE(refreshed_lines.size() == lines.size());
+    REQUIRE(std::count(refreshed_lines.begin(), refreshed_lines.end(), "cmake_mtime=0") == 0);
+}
+
+TEST_CASE("Toolchain async compile", "[Toolchain]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+
+    smce::Sketch sk{SKETCHES_PATH "noop", {.fqbn = "arduino:avr:nano"}};
+    std::string log;
+    auto handle = tc.compile_async(sk, [&](std::string_view chunk) { log += chunk; });
+    REQUIRE(handle.valid());
+    const auto ec = handle.wait();
+    if (ec)
+        std::cerr << log;
+    REQUIRE_FALSE(ec);
+    REQUIRE(handle.done());
+    REQUIRE(sk.is_compiled());
+    REQUIRE_FALSE(log.empty());
+    REQUIRE(log.ends_with('\n'));
+
+    smce::Sketch cancelled_sk{SKETCHES_PATH "noop", {.fqbn = "arduino:avr:nano"}};
+    auto cancelled = tc.compile_async(cancelled_sk);
+    cancelled.cancel();
+    REQUIRE(cancelled.wait() == smce::toolchain_error::compile_cancelled);
+    REQUIRE_FALSE(cancelled_sk.is_compiled());
+}
+
+TEST_CASE("Toolchain PGO", "[Toolchain]") {
+    smce::Toolchain tc{SMCE_PATH};
+    REQUIRE(!tc.check_suitable_environment());
+
+    [[maybe_unused]] std::error_code rm_ec;
+    std::filesystem::remove_all(SMCE_PATH "/pgo", rm_ec);
+
+    smce::Sketch sk{SKETCHES_PATH "pins", {.fqbn = "arduino:avr:nano", .pgo = smce::SketchConfig::Pgo::optimize}};
+    REQUIRE_FALSE(tc.has_profile(sk));
+    REQUIRE(tc.compile(sk) == smce::toolchain_error::profile_missing);
+
+    const auto ec = tc.compile_pgo(sk, {.pins = {0, 2}}, 500ms);
+    if (ec)
+        std::cerr << tc.build_log().second;
+    REQUIRE_FALSE(ec);
+    REQUIRE(sk.is_compiled());
+    REQUIRE(tc.has_profile(sk));
+
+    // Sketches built from the same source share a build directory, one at a time, but each keeps its own executable
+    {
+        const smce::SketchConfig twin_conf{.fqbn = "arduino:avr:nano", .pgo = smce::SketchConfig::Pgo::optimize};
+        smce::Sketch twin{SKETCHES_PATH "pins", twin_conf};
+        smce::Sketch other_twin{SKETCHES_PATH "pins", twin_conf};
+        auto twin_compile = tc.compile_async(twin);
+        auto other_twin_compile = tc.compile_async(other_twin);
+        REQUIRE_FALSE(twin_compile.wait());
+        REQUIRE_FALSE(other_twin_compile.wait());
+        REQUIRE(twin.is_compiled());
+        REQUIRE(other_twin.is_compiled());
+    }
+    // The shared build directory does not outlive the builds
+    for (const auto& entry : std::filesystem::directory_iterator{SMCE_PATH "/tmp"})
+        REQUIRE((!entry.is_directory() || !entry.path().filename().string().starts_with("pgo-")));
+
+    smce::Board br{};
+    REQUIRE(br.configure({}));
+    REQUIRE(br.attach_sketch(sk));
+    REQUIRE(br.start());
+    REQUIRE(br.stop());
+}
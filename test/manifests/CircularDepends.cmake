@@ -0,0 +1,4 @@
+set (PLUGIN_NAME "CircularDepends")
+set (PLUGIN_VERSION "0")
+set (PLUGIN_DEPENDS "CircularDepends")
+set (PLUGIN_URI "file:///")
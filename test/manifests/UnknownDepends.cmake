@@ -0,0 +1,4 @@
+set (PLUGIN_NAME "UnknownDepends")
+set (PLUGIN_VERSION "0")
+set (PLUGIN_DEPENDS "NotAPlugin")
+set (PLUGIN_URI "file:///")
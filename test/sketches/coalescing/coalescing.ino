@@ -0,0 +1,13 @@
+char buf[64];
+
+void setup() { Serial.begin(9600); }
+
+// Echoes what came in with a single write, then keeps the iteration busy for a while without sleeping
+void loop() {
+    const int count = Serial.available();
+    if (count <= 0)
+        return;
+    Serial.write(buf, Serial.readBytes(buf, count < 64 ? count : 64));
+    for (const unsigned long start = millis(); millis() - start < 200;) {
+    }
+}
@@ -0,0 +1,8 @@
+void setup() { Serial.begin(9600); }
+
+// Reports how long each delay actually lasted, in microseconds
+void loop() {
+    const unsigned long start = micros();
+    delay(2);
+    Serial.println(micros() - start);
+}